@@ -1,33 +1,43 @@
 #include "Customer.h"
+#include "CustomerCache.h"
+#include "Flight.h"
+
+CustomerCache *Customer::cache = nullptr;
+
+Customer::Customer(const std::string &n, const std::string &a, const std::string &pn, const std::string &flightid, int seatnum) :
+    name(n), address(a), phonenum(pn), flightid(flightid), seatnum(seatnum) {
+    if (cache) cache->track(this); // a brand new Customer is part of the working set
+}
+
+Customer::~Customer() {
+    if (cache) cache->forget(this); // the cache must not hold on to a pointer to a deleted Customer
+}
+
+// only ever called by ensureResident(), when the cache is set
+// the cache changes our data members, which is why it needs a non-const pointer
+void Customer::fetch() const {
+    cache->fetch(const_cast<Customer*>(this));
+}
+
+void Customer::changed() const {
+    if (!Flight::manifests) return;
+    ensureResident(); // a stub doesn't know its flight yet
+    Flight::manifests->invalidate(flightid);
+}
 
 // compare by name first, if names are the same, break ties using phone number, no customer can have the same name AND phone#
 // return -1 if less than, 0 if equal, 1 if greater than
 int Customer::compare(const Record *that) const {
-    const Customer *c = dynamic_cast<const Customer*>(that);
-    if (name < c->name) return -1;
-    else if (name > c->name) return 1;
-    else {
-        if (phonenum < c->phonenum) return -1;
-        else if (phonenum > c->phonenum) return 1;
-        else return 0;
-    }
+    // a tree only ever holds one type of Record, so there is no need for the slower (checked) dynamic_cast,
+    // and string::compare does each string in one pass instead of two (< and then >)
+    const Customer *c = static_cast<const Customer*>(that);
+    int byName = name.compare(c->name);
+    if (byName != 0) return byName < 0 ? -1 : 1;
+    int byPhone = phonenum.compare(c->phonenum);
+    return byPhone < 0 ? -1 : (byPhone > 0 ? 1 : 0);
 }
 
 std::string Customer::toString() const {
+    ensureResident();
     return name + ", " + address + ", " + phonenum;
 }
-
-void Customer::save(std::ofstream &fout) const {
-    writeString(fout, name);
-    writeString(fout, address);
-    writeString(fout, phonenum);
-    writeString(fout, flightid);
-    writeInt(fout, seatnum);
-}
-void Customer::load(std::ifstream &fin) {
-    name = readString(fin);
-    address = readString(fin);
-    phonenum = readString(fin);
-    flightid = readString(fin);
-    seatnum = readInt(fin);
-}
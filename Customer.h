@@ -3,14 +3,42 @@
 
 #include <string>
 #include "Record.h"
+#include "Serialization.h"
+
+class CustomerCache; // defined in CustomerCache.h, which itself needs this header
+
+// everything needed to book someone, before they have a seat (used for group bookings, see Database::bookGroup)
+struct Passenger {
+    std::string name, address, phonenum;
+};
 
 class Customer : public Record {
+    friend class CustomerCache; // the cache fills in and clears out the lazily loaded data members
+    friend class Snapshot; // as well as the snapshot, which decides where on disk each Customer goes
+    friend struct RecordLayout<Customer>;
 private:
     // strings are default initialized to be empty strings
     std::string name, address, phonenum;
     std::string flightid;
     int seatnum = -1;
+
+    // lazy loading (see CustomerCache.h):
+    // a 'stub' Customer only keeps its key (name and phonenum) in memory, while address, flightid and seatnum
+    // stay on disk until somebody asks for them, at which point the cache decodes them from data/data.dat
+    bool resident = true; // are address, flightid and seatnum actually in memory?
+    int recordSize = 0; // size in bytes of the on-disk record, so a stub can be copied to a new file without decoding it
+    long long offset = -1; // where this Customer's record starts in data/data.dat, -1 if it was never saved
+
+    void fetch() const;
+    inline void ensureResident() const {
+        STATS_COUNT(customerAccesses);
+        if (!resident) fetch();
+    }
+    void changed() const; // our flight's rendered manifests now show stale information
 public:
+    // when this is set, Customers are loaded lazily through it, when it is null every Customer is always resident
+    static CustomerCache *cache;
+
     // default constructor leaves data members with the default values mentioned above
     Customer() {}
 
@@ -18,29 +46,36 @@ public:
     Customer(const std::string &n, const std::string &pn) : name(n), phonenum(pn) {}
 
     // this is full constructor:
-    Customer(const std::string &n, const std::string &a, const std::string &pn, const std::string &flightid, int seatnum) :
-        name(n), address(a), phonenum(pn), flightid(flightid), seatnum(seatnum) {}
+    Customer(const std::string &n, const std::string &a, const std::string &pn, const std::string &flightid, int seatnum);
 
-    // rule of three: none of the three (copy assign, copy construct, destruct) are needed
+    // copying is already disallowed by Record, and the destructor only has to tell the cache that we are gone
+    ~Customer();
 
-    inline void setName(const std::string &n) { name = n; }
-    inline void setAddress(const std::string &a) { address = a; }
-    inline void setPhoneNumber(const std::string &pn) { phonenum = pn; }
-    inline void setFlightId(const std::string &id) { flightid = id; }
-    inline void setSeatNum(int i) { seatnum = i; }
+    // every setter tells the flight's manifest cache, since manifests show our details
+    inline void setName(const std::string &n) { name = n; changed(); }
+    inline void setAddress(const std::string &a) { ensureResident(); address = a; changed(); }
+    inline void setPhoneNumber(const std::string &pn) { phonenum = pn; changed(); }
+    inline void setFlightId(const std::string &id) { ensureResident(); changed(); flightid = id; changed(); } // both old and new flight
+    inline void setSeatNum(int i) { ensureResident(); seatnum = i; changed(); }
 
+    // name and phone number are always in memory, the rest might have to be loaded first
     inline std::string getName() const { return name; }
-    inline std::string getAddress() const { return address; }
+    inline std::string getAddress() const { ensureResident(); return address; }
     inline std::string getPhoneNumber() const { return phonenum; }
-    inline std::string getFlightId() const { return flightid; }
-    inline int getSeatNum() const { return seatnum; }
+    inline std::string getFlightId() const { ensureResident(); return flightid; }
+    inline int getSeatNum() const { ensureResident(); return seatnum; }
 
     int compare(const Record *that) const override;
-    Record* duplicateType() const override { return new Customer(); }
-    void save(std::ofstream &fout) const override;
-    void load(std::ifstream &fin) override;
 
     std::string toString() const;
 };
 
+// what a Customer looks like on disk (see Serialization.h)
+template<> struct RecordLayout<Customer> {
+    static constexpr auto keyFields() { return std::make_tuple(&Customer::name, &Customer::phonenum); }
+    static constexpr auto payloadFields() { return std::make_tuple(&Customer::address, &Customer::flightid, &Customer::seatnum); }
+    static Customer* make() { return new Customer(); }
+    static void loaded(Customer &c) { c.resident = true; }
+};
+
 #endif // CUSTOMER_H
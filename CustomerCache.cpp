@@ -0,0 +1,87 @@
+#include "CustomerCache.h"
+#include "Snapshot.h"
+
+void CustomerCache::open(const std::string &dataPath) {
+    path = dataPath;
+    fin.open(dataPath, std::ios::binary);
+    if (!fin.good()) return; // nothing saved yet, so there are no stubs to load either
+    reader.reset(new ByteReader(fin, 4096)); // records are small, so don't read much more than we need
+    if (!Snapshot::readHeader(*reader)) reader.reset(); // then it can't have any of our records either
+}
+void CustomerCache::close() {
+    reader.reset();
+    fin.close();
+}
+
+// a reader stays bad once it has read past the end, so it is replaced with a new one on the file as it is now
+bool CustomerCache::ready() {
+    if (reader && reader->good()) return true;
+    close();
+    open(path);
+    return reader != nullptr;
+}
+
+void CustomerCache::fetch(Customer *c) {
+    STATS_COUNT(customerFetches);
+    if (!ready()) {
+        failed++;
+        return;
+    }
+    reader->seek(c->offset);
+    readPayload(*reader, *c); // name and phonenum are already in the stub, this fills in the rest
+    if (!reader->good()) {
+        makeStub(c); // whatever was read is garbage
+        failed++;
+        return;
+    }
+
+    track(c);
+}
+
+void CustomerCache::track(Customer *c) {
+    auto it = positions.find(c);
+    if (it != positions.end()) lru.erase(it->second); // already tracked, move it to the front
+    lru.push_front(c);
+    positions[c] = lru.begin();
+    evictExtra();
+}
+
+void CustomerCache::forget(Customer *c) {
+    auto it = positions.find(c);
+    if (it == positions.end()) return;
+    lru.erase(it->second);
+    positions.erase(it);
+}
+
+void CustomerCache::evictExtra() {
+    // a Customer that has never been saved has nowhere to be reloaded from, so it has to stay resident
+    // (there are very few of those, since the databases are saved after every change)
+    // the front of the list is never evicted, since it is the Customer somebody is using right now
+    auto it = lru.end();
+    while (lru.size() > capacity && --it != lru.begin()) {
+        Customer *c = *it;
+        if (c->offset < 0) continue;
+
+        makeStub(c);
+        STATS_COUNT(customerEvictions);
+
+        positions.erase(c);
+        it = lru.erase(it);
+    }
+}
+
+void CustomerCache::makeStub(Customer *c) {
+    std::string().swap(c->address); // swapping with an empty string actually frees the memory
+    std::string().swap(c->flightid);
+    c->seatnum = -1;
+    c->resident = false;
+}
+
+bool CustomerCache::copyRecord(long long offset, int size, ByteWriter &w) {
+    if (!ready()) return false;
+    reader->seek(offset);
+    std::string buffer(size, '\0');
+    reader->getBytes(&buffer[0], size);
+    w.putBytes(buffer.data(), size);
+    return reader->good();
+}
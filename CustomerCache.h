@@ -0,0 +1,67 @@
+#ifndef CUSTOMERCACHE_H
+#define CUSTOMERCACHE_H
+
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Customer.h"
+#include "Serialization.h"
+
+/*
+    Lazy customer loading
+
+    Most sessions only look at a handful of customers, so instead of decoding every Customer at startup,
+    a lazy load (see Snapshot.h) only reads every customer's name and phone number, works out where the rest
+    of their record is in data/data.dat, and links them to their seats.
+
+    The customers RBTree is then made of 'stub' Customers (see Customer.h), and the first time
+    anyone asks a stub for its address, flight or seat, the record is decoded from data/data.dat.
+    Decoded Customers are kept in a least-recently-used list, and once more than 'capacity' of them are resident,
+    the least recently used ones are turned back into stubs, so memory depends on the working set
+    rather than on the size of the database.
+
+    If a record can't be read (e.g. the file was briefly unreadable, or something else changed it),
+    the Customer stays a stub and the failure is counted, so Database can report it instead of showing blank details.
+    The file is opened again on the next access, so one bad read doesn't break every fetch after it.
+*/
+class CustomerCache {
+private:
+    std::string path; // data/data.dat, kept so that it can be opened again after a failed read
+    std::ifstream fin; // the same file, kept open so that records can be decoded whenever they are needed
+    std::unique_ptr<ByteReader> reader; // reads from fin, kept around since it remembers the last block it decompressed
+    size_t capacity; // how many resident Customers we keep before evicting
+    size_t failed = 0; // fetches which couldn't read their record
+
+    // front of the list is the most recently used Customer, back is the next one to be evicted
+    std::list<Customer*> lru;
+    std::unordered_map<Customer*, std::list<Customer*>::iterator> positions; // where each Customer sits in lru
+
+    bool ready(); // opens the file again if the reader went bad, returns false if it still can't be read
+    void evictExtra(); // turn least recently used Customers back into stubs until we are within capacity
+    static void makeStub(Customer *c); // free c's lazily loaded data members
+
+public:
+    CustomerCache(size_t capacity) : capacity(capacity) {}
+    // rule of three: nothing to free by hand, and the ifstream member already can't be copied
+
+    void open(const std::string &dataPath);
+    void close();
+
+    // decode a stub's record from disk
+    // if the file is missing or broken (e.g. something else changed it), c stays a stub and failures() goes up
+    void fetch(Customer *c);
+    void track(Customer *c); // mark c as the most recently used resident Customer
+    void forget(Customer *c); // c is being deleted
+
+    // copy size bytes, starting at offset in the currently open file, into w
+    // returns false if they couldn't be read, in which case the file being written is missing a record
+    bool copyRecord(long long offset, int size, ByteWriter &w);
+
+    inline size_t residentCount() const { return lru.size(); }
+    // how many fetches have failed so far, compare it before and after using a Customer to see if its details are real
+    inline size_t failures() const { return failed; }
+};
+
+#endif // CUSTOMERCACHE_H
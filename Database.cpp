@@ -0,0 +1,340 @@
+#include "Database.h"
+#include "Snapshot.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+Database::Database(const std::string &path) : path(path), customerCache(CUSTOMER_CACHE_CAPACITY), manifestCache(MANIFEST_CACHE_BUDGET) {
+    Flight::manifests = &manifestCache;
+    load();
+}
+
+Database::~Database() {
+    // everything is about to be deleted anyway, so the caches don't need to hear about it
+    Customer::cache = nullptr;
+    Flight::manifests = nullptr;
+}
+
+bool Database::startRecording(const std::string &tracePath) {
+    recorder.reset(new TraceRecorder(tracePath));
+    if (!recorder->good()) recorder.reset();
+    return recorder != nullptr;
+}
+
+void Database::stopRecording() {
+    recorder.reset();
+}
+
+void Database::record(const Operation &op) {
+    if (recorder) recorder->record(op);
+}
+
+Flight* Database::getFlight(const std::string &id) {
+    // we can allocate this on the stack and use the constructor that leaves its heap memory uninitialized
+    // since it doesnt actually store anything, its used only to search the RBTree via comparisons
+    Flight key(id); // there will be more instances of objects used like this later on
+    return dynamic_cast<Flight*>(flights.get(&key));
+}
+
+Database::Result Database::addFlight(const std::string &id, int numSeats) {
+    Operation op;
+    op.type = Operation::ADD_FLIGHT;
+    op.flightId = id;
+    op.number = numSeats;
+    record(op);
+    STATS_TIME(operations[Operation::ADD_FLIGHT]);
+
+    Flight *flight = new Flight(id, numSeats);
+    if (flights.contains(flight)) {
+        delete flight;
+        return FLIGHT_EXISTS;
+    }
+    flights.insert(flight);
+    return save() ? OK : DISK_ERROR;
+}
+
+Database::Result Database::removeFlight(const std::string &id) {
+    Operation op;
+    op.type = Operation::REMOVE_FLIGHT;
+    op.flightId = id;
+    record(op);
+    STATS_TIME(operations[Operation::REMOVE_FLIGHT]);
+
+    Flight *flight = getFlight(id);
+    if (flight == nullptr) return NO_FLIGHT;
+
+    // before erasing flight, remove all customers who booked this flight, all in one go:
+    std::vector<Record*> passengers;
+    passengers.reserve(flight->getOccupiedCount());
+    flight->forEachPassenger([this, &passengers](int, Customer *c) {
+        names.erase(c); // while c still exists
+        passengers.push_back(c);
+    });
+    customers.eraseAll(passengers);
+
+    Flight key(id); // erase through a key, since the Flight itself is deleted part way through
+    flights.erase(&key);
+    return save() ? OK : DISK_ERROR;
+}
+
+Database::Result Database::queryFlight(const std::string &id, bool occupiedOnly, bool sortByName, std::string &manifest) {
+    Operation op;
+    op.type = Operation::QUERY_FLIGHT;
+    op.flightId = id;
+    op.occupiedOnly = occupiedOnly;
+    op.sortByName = sortByName;
+    record(op);
+    STATS_TIME(operations[Operation::QUERY_FLIGHT]);
+
+    Flight *flight = getFlight(id);
+    if (flight == nullptr) return NO_FLIGHT;
+    size_t failures = customerCache.failures();
+    manifest = sortByName ? flight->toSortedString() : flight->toString(occupiedOnly);
+    if (customerCache.failures() != failures) { // some passengers' details came out blank
+        manifestCache.invalidate(id); // so they are read again next time instead of being kept
+        manifest.clear();
+        return DISK_ERROR;
+    }
+    return OK;
+}
+
+Database::Result Database::book(const std::string &name, const std::string &address, const std::string &phonenum, const std::string &flightId, int seatNum) {
+    Operation op;
+    op.type = Operation::BOOK;
+    op.flightId = flightId;
+    op.name = name;
+    op.address = address;
+    op.phonenum = phonenum;
+    op.number = seatNum;
+    record(op);
+    STATS_TIME(operations[Operation::BOOK]);
+
+    Flight *flight = getFlight(flightId);
+    if (flight == nullptr) return NO_FLIGHT;
+    if (seatNum < 0 || seatNum >= flight->getSize()) return SEAT_OUT_OF_RANGE;
+    if (flight->getSeat(seatNum) != nullptr) return SEAT_TAKEN;
+
+    if (isBooked(name, phonenum)) return CUSTOMER_EXISTS;
+    seat(flight, seatNum, name, address, phonenum);
+    return save() ? OK : DISK_ERROR;
+}
+
+Database::Result Database::bookAnySeat(const std::string &name, const std::string &address, const std::string &phonenum, const std::string &flightId, int &seatNum) {
+    Operation op;
+    op.type = Operation::BOOK_ANY_SEAT;
+    op.flightId = flightId;
+    op.name = name;
+    op.address = address;
+    op.phonenum = phonenum;
+    record(op);
+    STATS_TIME(operations[Operation::BOOK_ANY_SEAT]);
+
+    Flight *flight = getFlight(flightId);
+    if (flight == nullptr) return NO_FLIGHT;
+    if (isBooked(name, phonenum)) return CUSTOMER_EXISTS;
+    seatNum = flight->findFreeSeats(1, Flight::BEST_FIT);
+    if (seatNum == -1) return NO_ROOM;
+
+    seat(flight, seatNum, name, address, phonenum);
+    return save() ? OK : DISK_ERROR;
+}
+
+Database::Result Database::bookGroup(const std::vector<Passenger> &group, const std::string &flightId, int &firstSeat) {
+    Operation op;
+    op.type = Operation::BOOK_GROUP;
+    op.flightId = flightId;
+    op.group = group;
+    record(op);
+    STATS_TIME(operations[Operation::BOOK_GROUP]);
+
+    Flight *flight = getFlight(flightId);
+    if (flight == nullptr) return NO_FLIGHT;
+    if (group.empty()) return OK;
+
+    // check everyone before booking anyone, so a group is never half booked
+    for (size_t i = 0; i < group.size(); i++) {
+        if (isBooked(group[i].name, group[i].phonenum)) return CUSTOMER_EXISTS;
+        for (size_t j = 0; j < i; j++)
+            if (group[j].name == group[i].name && group[j].phonenum == group[i].phonenum) return CUSTOMER_EXISTS;
+    }
+    firstSeat = flight->findFreeSeats(group.size(), Flight::BEST_FIT);
+    if (firstSeat == -1) return NO_ROOM;
+
+    for (size_t i = 0; i < group.size(); i++)
+        seat(flight, firstSeat + i, group[i].name, group[i].address, group[i].phonenum);
+    return save() ? OK : DISK_ERROR;
+}
+
+bool Database::isBooked(const std::string &name, const std::string &phonenum) {
+    Customer key(name, phonenum); // another key object
+    return customers.contains(&key);
+}
+
+// seatNum must be free and the customer must not be booked yet
+void Database::seat(Flight *flight, int seatNum, const std::string &name, const std::string &address, const std::string &phonenum) {
+    Customer *customer = new Customer(name, address, phonenum, flight->getId(), seatNum);
+    customers.insert(customer);
+    names.insert(customer);
+    flight->setSeat(seatNum, customer);
+}
+
+Database::Result Database::find(const std::string &name, const std::string &phonenum, Customer *&customer) {
+    Operation op;
+    op.type = Operation::FIND;
+    op.name = name;
+    op.phonenum = phonenum;
+    record(op);
+    STATS_TIME(operations[Operation::FIND]);
+
+    Customer key(name, phonenum); // another key object
+    customer = dynamic_cast<Customer*>(customers.get(&key)); // full customer info
+    if (customer == nullptr) return NO_CUSTOMER;
+    return loadDetails({customer}) ? OK : DISK_ERROR;
+}
+
+Database::Result Database::cancel(const std::string &name, const std::string &phonenum) {
+    Operation op;
+    op.type = Operation::CANCEL;
+    op.name = name;
+    op.phonenum = phonenum;
+    record(op);
+    STATS_TIME(operations[Operation::CANCEL]);
+
+    Customer key(name, phonenum);
+    Customer *customer = dynamic_cast<Customer*>(customers.get(&key));
+    if (customer == nullptr) return NO_CUSTOMER;
+
+    // we first need to find the flight that this customer is on and clear their seat
+    Flight *flight = getFlight(customer->getFlightId());
+    if (flight == nullptr) return DISK_ERROR; // their record couldn't be loaded (see CustomerCache::fetch)
+    flight->setSeat(customer->getSeatNum(), nullptr);
+    names.erase(customer);
+    customers.erase(customer);
+    return save() ? OK : DISK_ERROR;
+}
+
+Database::Result Database::searchNames(const std::string &query, size_t k, std::vector<Customer*> &matches) {
+    Operation op;
+    op.type = Operation::SEARCH_NAME;
+    op.name = query;
+    op.number = k;
+    record(op);
+    STATS_TIME(operations[Operation::SEARCH_NAME]);
+
+    matches = names.search(query, k);
+    return loadDetails(matches) ? OK : DISK_ERROR;
+}
+
+// a lazy customer is loaded here rather than by whoever shows it, so that a record which can't be read
+// is reported as DISK_ERROR instead of being shown with blank details
+bool Database::loadDetails(const std::vector<Customer*> &found) {
+    size_t failures = customerCache.failures();
+    for (Customer *c : found) c->getSeatNum();
+    return customerCache.failures() == failures;
+}
+
+void Database::load() {
+    STATS_TIME(loads);
+    if (LAZY_CUSTOMERS) {
+        Customer::cache = &customerCache;
+        customerCache.open(path);
+    }
+    // the snapshot holds the flights, the customers and which customer sits in which seat (see Snapshot.h)
+    // in lazy mode the customers' details are left on disk until they are needed
+    switch (Snapshot::load(path, flights, customers, LAZY_CUSTOMERS)) {
+    case Snapshot::UPGRADED: // written by an older version, it is all in memory now, so rewrite it in the current format
+        save();
+        break;
+    case Snapshot::UNREADABLE:
+        loadProblem = path + " is damaged or from a newer version, so it was left as it is and nothing will be saved";
+        break;
+    default:
+        break;
+    }
+    // names are part of the key, so this doesn't load any lazy customers
+    customers.forEach([this](Record *r) { names.insert(static_cast<Customer*>(r)); });
+}
+
+// replaces to with from in a single step, so there is always a complete database file on disk, whatever happens
+static bool replaceFile(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0; // rename won't replace a file here
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool Database::save() {
+    if (!loadProblem.empty()) return false; // see getLoadProblem
+    STATS_TIME(saves);
+    // we write to a temporary file first, since customers which were never loaded are copied over from the old file,
+    // and the old file is only replaced once the new one is complete
+    std::string tmpPath = path + ".tmp";
+    Snapshot::Offsets offsets;
+    if (!Snapshot::save(tmpPath, flights, customers, COMPRESS_DATABASE, offsets)) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    customerCache.close(); // some systems won't let us replace a file that is still open
+    bool replaced = replaceFile(tmpPath, path);
+    if (replaced) Snapshot::useOffsets(offsets);
+    else std::remove(tmpPath.c_str());
+    if (LAZY_CUSTOMERS) customerCache.open(path); // the new file, or the old one again
+    return replaced;
+}
+
+std::string Database::pinSnapshot() {
+    std::string pinPath = path + ".pinned" + std::to_string(++pins);
+    std::error_code error;
+    std::filesystem::remove(pinPath, error); // left behind by a run that crashed
+#ifndef _WIN32
+    // a hard link is instant and takes no space, and the file it names stays as it is when save replaces path
+    std::filesystem::create_hard_link(path, pinPath, error);
+    if (!error) return pinPath;
+#endif
+    // Windows won't replace path while the same file is open under another name, and some file systems have no hard links
+    if (!std::filesystem::copy_file(path, pinPath, error)) {
+        std::filesystem::remove(pinPath, error);
+        return "";
+    }
+    return pinPath;
+}
+
+Diagnostics Database::diagnostics() {
+    Diagnostics d;
+    d.values.push_back({"flights", static_cast<double>(flights.size())});
+    d.values.push_back({"flight_tree_height", static_cast<double>(flights.height())});
+    d.values.push_back({"customers", static_cast<double>(customers.size())});
+    d.values.push_back({"customer_shards", static_cast<double>(customers.numShards())});
+    d.values.push_back({"customer_shard_height", static_cast<double>(customers.height())});
+    d.values.push_back({"distinct_customer_names", static_cast<double>(names.size())});
+    d.values.push_back({"customers_resident", static_cast<double>(LAZY_CUSTOMERS ? customerCache.residentCount() : customers.size())});
+    d.values.push_back({"manifest_cache_hits", static_cast<double>(manifestCache.hits())});
+    d.values.push_back({"manifest_cache_misses", static_cast<double>(manifestCache.misses())});
+    d.values.push_back({"manifest_cache_bytes", static_cast<double>(manifestCache.bytesUsed())});
+
+#ifdef AIRLINE_STATS
+    long long lookups = Stats::lookups, accesses = Stats::customerAccesses, saves = Stats::saves.count();
+    d.values.push_back({"lookups", static_cast<double>(lookups)});
+    d.values.push_back({"comparisons_per_lookup", lookups ? static_cast<double>(Stats::comparisons) / lookups : 0});
+    d.values.push_back({"nodes_allocated", static_cast<double>(Stats::nodesAllocated)});
+    d.values.push_back({"nodes_live", static_cast<double>(Stats::nodesAllocated - Stats::nodesFreed)});
+    d.values.push_back({"records_allocated", static_cast<double>(Stats::recordsAllocated)});
+    d.values.push_back({"records_live", static_cast<double>(Stats::recordsAllocated - Stats::recordsFreed)});
+    d.values.push_back({"customer_cache_hit_rate", accesses ? 1 - static_cast<double>(Stats::customerFetches) / accesses : 0});
+    d.values.push_back({"customer_cache_evictions", static_cast<double>(Stats::customerEvictions)});
+    d.values.push_back({"bytes_per_save", saves ? static_cast<double>(Stats::bytesSaved) / saves : 0});
+
+    for (int type = Operation::ADD_FLIGHT; type < Operation::NUM_TYPES; type++)
+        d.latencies.push_back({Operation::typeName(static_cast<Operation::Type>(type)), Stats::operations[type]});
+    d.latencies.push_back({"load", Stats::loads});
+    d.latencies.push_back({"save", Stats::saves});
+#endif
+    return d;
+}
@@ -0,0 +1,115 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <memory>
+#include <string>
+#include "RBTree.h"
+#include "Flight.h"
+#include "Customer.h"
+#include "CustomerCache.h"
+#include "ManifestCache.h"
+#include "NameIndex.h"
+#include "ShardedCustomerStore.h"
+#include "OperationTrace.h"
+#include "Stats.h"
+
+/*
+    The airline database, without any GUI
+
+    MainWindow only reads what the user typed and shows the results, every operation itself happens here,
+    so the console program (see cli/main.cpp) can run exactly the same code, e.g. when replaying a trace.
+
+    Every operation returns a Result saying whether it worked, and if not, why.
+    When recording (see OperationTrace.h), every operation is written to the trace before it runs.
+
+    Customer::cache and Flight::manifests are pointed at this Database's caches while it exists,
+    so only one Database can be open at a time.
+*/
+class Database {
+public:
+    // DISK_ERROR means the database file couldn't be written, so the change was made but only in memory
+    // (the previous file is kept as it was), or that a customer's details couldn't be read back from it
+    enum Result { OK, NO_FLIGHT, FLIGHT_EXISTS, SEAT_OUT_OF_RANGE, SEAT_TAKEN, NO_CUSTOMER, CUSTOMER_EXISTS, NO_ROOM, DISK_ERROR };
+
+    // when true, customers are loaded from disk on demand instead of all at once (see CustomerCache.h)
+    static const bool LAZY_CUSTOMERS = true;
+    static const size_t CUSTOMER_CACHE_CAPACITY = 4096; // most fully loaded customers kept in memory at once
+    // save the database in the compressed format (see Snapshot.h), which makes the file about 6 times smaller,
+    // but every save about twice as slow (and it is saved after every change), as well as every lazy customer fetch
+    // either format can always be loaded, so this can be changed without converting anything
+    static const bool COMPRESS_DATABASE = false;
+    static const size_t MANIFEST_CACHE_BUDGET = 8 << 20; // most bytes of rendered manifests kept at once
+
+private:
+    std::string path; // the database file
+
+    // declared before the databases so that they are destroyed after them
+    CustomerCache customerCache;
+    ManifestCache manifestCache;
+
+    RBTree flights; // database objects
+    ShardedCustomerStore customers; // can be split into shards for parallel bookings, but isn't yet (see ShardedCustomerStore.h)
+    NameIndex names; // every customer again, by name only, for searching (see NameIndex.h)
+
+    std::unique_ptr<TraceRecorder> recorder; // null when not recording
+    std::string loadProblem; // why the database file couldn't be loaded, empty if it could (or there wasn't one yet)
+    int pins = 0; // snapshots pinned so far, numbers their files
+
+    void load();
+    bool save(); // returns false, keeping the previous file, if the new one couldn't be written
+    bool isBooked(const std::string &name, const std::string &phonenum);
+    void seat(Flight *flight, int seatNum, const std::string &name, const std::string &address, const std::string &phonenum);
+    void record(const Operation &op);
+    bool loadDetails(const std::vector<Customer*> &found); // false if any of their records couldn't be read
+
+public:
+    explicit Database(const std::string &path); // loads the database file, if it exists
+    ~Database(); // 1 of 3
+    Database& operator=(const Database &rhs) = delete; // 2 of 3
+    Database(const Database &db) = delete; // 3 of 3
+
+    // a database file that exists but can't be read is never saved over, since it might still be somebody's only copy:
+    // the database starts out empty, every change returns DISK_ERROR, and this says what is wrong (empty if nothing is)
+    inline const std::string& getLoadProblem() const { return loadProblem; }
+
+    // start writing every operation to a trace file, returns false if it can't be created
+    bool startRecording(const std::string &tracePath);
+    void stopRecording();
+
+    Result addFlight(const std::string &id, int numSeats);
+    Result removeFlight(const std::string &id); // also cancels everyone booked on it
+    // manifest is left empty with DISK_ERROR if some passengers' details couldn't be read
+    Result queryFlight(const std::string &id, bool occupiedOnly, bool sortByName, std::string &manifest);
+
+    Result book(const std::string &name, const std::string &address, const std::string &phonenum, const std::string &flightId, int seatNum);
+    // these pick the seats themselves (see SeatAllocator.h), and set seatNum/firstSeat to what they picked
+    // a single passenger gets a seat from the shortest free run, so longer runs are kept for groups
+    Result bookAnySeat(const std::string &name, const std::string &address, const std::string &phonenum, const std::string &flightId, int &seatNum);
+    // everyone in the group gets seats next to each other, or nobody is booked
+    // (NO_ROOM if there aren't that many free seats in a row, CUSTOMER_EXISTS if anyone is already booked or listed twice)
+    Result bookGroup(const std::vector<Passenger> &group, const std::string &flightId, int &firstSeat);
+    // customer is set to the reservation that was found, and stays valid until the database changes
+    // (DISK_ERROR if it was found but its details couldn't be read, see CustomerCache.h)
+    Result find(const std::string &name, const std::string &phonenum, Customer *&customer);
+    Result cancel(const std::string &name, const std::string &phonenum);
+    // matches is set to the customers whose name starts with, contains, or is a close misspelling of query,
+    // at most k of them, and the pointers stay valid until the database changes
+    // (DISK_ERROR if some of their details couldn't be read)
+    Result searchNames(const std::string &query, size_t k, std::vector<Customer*> &matches);
+
+    Flight* getFlight(const std::string &id); // nullptr if there is no such flight
+
+    // every change is saved straight away, so this file always holds the whole database (e.g. for Exporter.h)
+    inline const std::string& getPath() const { return path; }
+    // another name for the database file as it is now, which later saves leave alone (they swap in a new file at path),
+    // so it can be read on another thread while changes go on, e.g. for an export
+    // returns the new file's path, or an empty string if it couldn't be made; the caller deletes it once done
+    std::string pinSnapshot();
+
+    inline const ManifestCache& manifests() const { return manifestCache; }
+
+    // sizes and cache counters, plus everything in Stats when it is compiled in (see Stats.h)
+    Diagnostics diagnostics();
+};
+
+#endif // DATABASE_H
@@ -0,0 +1,12 @@
+#include "DatabaseWorker.h"
+
+DatabaseWorker::DatabaseWorker(const std::string &path, QObject *parent) : QObject(parent) {
+    pool.setMaxThreadCount(1); // one operation at a time (see DatabaseWorker.h)
+    pool.setExpiryTimeout(-1); // keep the thread around instead of starting a new one after every quiet spell
+    pool.start([this, path]() { db.reset(new Database(path)); });
+}
+
+DatabaseWorker::~DatabaseWorker() {
+    // the watchers are our children, so results which are still on their way are simply never delivered
+    pool.waitForDone();
+}
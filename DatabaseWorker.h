@@ -0,0 +1,80 @@
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "Database.h"
+
+/*
+    Running database operations off the GUI thread
+
+    Formatting a big manifest, removing a flight with lots of passengers and saving the whole database afterwards
+    can each take long enough to freeze the window if they run inside a slot.
+    Instead, MainWindow hands every operation over as a function taking the Database, which runs on a worker thread,
+    and its result comes back on the GUI thread through a QFutureWatcher's finished signal,
+    so the window keeps drawing and taking input in the meantime.
+
+    The Database and its caches aren't thread-safe, so the pool only has a single thread and operations run one at a time,
+    in the order they were posted: every operation sees the database exactly as the ones before it left it,
+    and the GUI thread never touches the Database at all. This is also why results must be plain copies
+    (strings, numbers), never pointers into the database, and why work must return something (e.g. a Database::Result).
+
+    Some results only matter until the user asks again (the manifest on screen, the name search, the diagnostics),
+    those are posted on a channel with postLatest: a newer request on the same channel makes the older ones stale,
+    so they are skipped if they haven't started yet, and their results are dropped if they have.
+*/
+class DatabaseWorker : public QObject {
+    Q_OBJECT
+public:
+    enum Channel { MANIFEST, NAME_SEARCH, DIAGNOSTICS, NUM_CHANNELS };
+
+private:
+    QThreadPool pool;
+    std::unique_ptr<Database> db; // only ever used on the pool's thread
+    std::atomic<int> latest[NUM_CHANNELS] = {}; // newest ticket handed out on every channel
+
+public:
+
+    // the database is loaded on the worker too, anything posted meanwhile waits for it
+    explicit DatabaseWorker(const std::string &path, QObject *parent = nullptr);
+    ~DatabaseWorker(); // 1 of 3: waits for everything that was posted
+    DatabaseWorker& operator=(const DatabaseWorker &rhs) = delete; // 2 of 3
+    DatabaseWorker(const DatabaseWorker &dw) = delete; // 3 of 3
+
+    // runs work(database) on the worker, then done(result) on the GUI thread
+    template<class Work, class Done>
+    void post(Work work, Done done) {
+        typedef decltype(work(*db)) Result;
+        // the watcher belongs to the GUI thread, so that is where it emits finished, and it deletes itself afterwards
+        QFutureWatcher<Result> *watcher = new QFutureWatcher<Result>(this);
+        connect(watcher, &QFutureWatcher<Result>::finished, this, [watcher, done]() {
+            done(watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run(&pool, [this, work]() { return work(*db); }));
+    }
+
+    // like post, but only the newest request on the channel gets done() called
+    template<class Work, class Done>
+    void postLatest(Channel channel, Work work, Done done) {
+        int ticket = ++latest[channel];
+        post([this, channel, ticket, work](Database &database) {
+            if (latest[channel] != ticket) return decltype(work(database))(); // a newer request is already waiting
+            return work(database);
+        }, [this, channel, ticket, done](const auto &result) {
+            if (latest[channel] == ticket) done(result);
+        });
+    }
+
+    // makes everything posted on the channel so far stale, without posting anything new
+    // for when the user asks again but there is nothing to look up (e.g. an empty flight id), so an older result
+    // doesn't show up in place of the error
+    inline void cancel(Channel channel) { ++latest[channel]; }
+};
+
+#endif // DATABASEWORKER_H
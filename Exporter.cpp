@@ -0,0 +1,132 @@
+#include "Exporter.h"
+#include "Snapshot.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+
+// the text is written through the same buffered writer as the database file, so it goes out in big chunks
+static void put(ByteWriter &w, const std::string &s) {
+    w.putBytes(s.data(), s.size());
+}
+static void put(ByteWriter &w, const char *s) {
+    while (*s) w.putByte(*s++);
+}
+static void put(ByteWriter &w, long long i) {
+    char digits[24];
+    char *end = std::to_chars(digits, digits + sizeof(digits), i).ptr; // no locale and no allocation, unlike to_string
+    w.putBytes(digits, end - digits);
+}
+
+// a CSV field only needs quotes if it has a comma, quote or line break in it, and quotes inside are doubled
+static void putCsv(ByteWriter &w, const std::string &s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        put(w, s);
+        return;
+    }
+    w.putByte('"');
+    for (char c : s) {
+        if (c == '"') w.putByte('"');
+        w.putByte(c);
+    }
+    w.putByte('"');
+}
+
+static void putJson(ByteWriter &w, const std::string &s) {
+    w.putByte('"');
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            w.putByte('\\');
+            w.putByte(c);
+        }
+        else if (c < 0x20) { // control characters have to be escaped, anything else (including UTF-8) goes as it is
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            put(w, escaped);
+        }
+        else w.putByte(c);
+    }
+    w.putByte('"');
+}
+
+Exporter::Format Exporter::formatFor(const std::string &path) {
+    const std::string extension = ".json";
+    bool json = path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    return json ? JSON : CSV;
+}
+
+bool Exporter::exportSnapshot(const std::string &snapshotPath, const std::string &outPath, Format format, long long &rows) {
+    rows = 0;
+    { // don't create (or empty out) the output file for something that isn't a database file
+        std::ifstream fin(snapshotPath, std::ios::binary);
+        ByteReader in(fin, 16);
+        if (!fin.good() || !Snapshot::readHeader(in)) return false;
+    }
+    std::ofstream fout(outPath, std::ios::binary); // binary, so line endings are the same everywhere
+    if (!fout.good()) return false;
+    ByteWriter w(fout);
+
+    bool firstFlight = true, firstCustomer = true;
+    auto onFlight = [&](const Snapshot::FlightRow &f) {
+        if (format == CSV) {
+            put(w, "flight,");
+            putCsv(w, f.id);
+            w.putByte(',');
+            put(w, f.seats);
+            w.putByte(',');
+            put(w, f.occupied);
+            put(w, ",,,,\n");
+        }
+        else {
+            put(w, firstFlight ? "\n" : ",\n");
+            put(w, "{\"id\":");
+            putJson(w, f.id);
+            put(w, ",\"seats\":");
+            put(w, f.seats);
+            put(w, ",\"occupied\":");
+            put(w, f.occupied);
+            w.putByte('}');
+        }
+        firstFlight = false;
+        rows++;
+    };
+    auto onCustomer = [&](const Snapshot::CustomerRow &c) {
+        if (format == CSV) {
+            put(w, "customer,");
+            putCsv(w, c.flightId);
+            put(w, ",,,");
+            put(w, c.seat);
+            w.putByte(',');
+            putCsv(w, c.name);
+            w.putByte(',');
+            putCsv(w, c.phonenum);
+            w.putByte(',');
+            putCsv(w, c.address);
+            w.putByte('\n');
+        }
+        else {
+            // the customers list only starts once the flights are done, which is when the first customer shows up
+            if (firstCustomer) put(w, "\n],\"customers\":[");
+            put(w, firstCustomer ? "\n" : ",\n");
+            put(w, "{\"name\":");
+            putJson(w, c.name);
+            put(w, ",\"phone\":");
+            putJson(w, c.phonenum);
+            put(w, ",\"address\":");
+            putJson(w, c.address);
+            put(w, ",\"flight\":");
+            putJson(w, c.flightId);
+            put(w, ",\"seat\":");
+            put(w, c.seat);
+            w.putByte('}');
+        }
+        firstCustomer = false;
+        rows++;
+    };
+
+    put(w, format == CSV ? "record,flight,seats,occupied,seat,name,phone,address\n" : "{\"flights\":[");
+    bool ok = Snapshot::scan(snapshotPath, onFlight, onCustomer);
+    if (format == JSON) put(w, firstCustomer ? "\n],\"customers\":[\n]}\n" : "\n]}\n");
+    w.finish();
+    return ok && fout.good();
+}
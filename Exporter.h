@@ -0,0 +1,34 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <string>
+
+/*
+    Exporting the database as CSV or JSON, for spreadsheets and other programs
+
+    The rows come straight from a saved database file (see Snapshot::scan) instead of the trees in memory, so:
+    - nothing in the Database is locked or even touched, bookings can go on while a big export runs
+      (every save writes a new file and swaps it in, so a file pinned with Database::pinSnapshot never changes under us)
+    - memory use doesn't grow with the database, every row is formatted on its own into a buffered writer
+
+    CSV is a single table, the first column says whether the row is a flight or a customer:
+        record,flight,seats,occupied,seat,name,phone,address
+        flight,AC100,50,1,,,,
+        customer,AC100,,,12,Anna Smith,(555) 555-5555,"1 Main St, Springfield"
+    JSON is a single object holding both lists:
+        {"flights":[{"id":"AC100","seats":50,"occupied":1}],
+         "customers":[{"name":"Anna Smith","phone":"(555) 555-5555","address":"...","flight":"AC100","seat":12}]}
+    flights come first, then customers, each sorted the same way as in the database
+*/
+class Exporter {
+public:
+    enum Format { CSV, JSON };
+
+    static Format formatFor(const std::string &path); // JSON for a .json file, CSV for anything else
+
+    // returns false if snapshotPath isn't a valid database file or outPath can't be written
+    // rows is set to the number of flights and customers written
+    static bool exportSnapshot(const std::string &snapshotPath, const std::string &outPath, Format format, long long &rows);
+};
+
+#endif // EXPORTER_H
@@ -1,25 +1,36 @@
 #include "Flight.h"
 
 #include <iostream>
-#include <cstring>
 #include <sstream>
 #include <algorithm>
 
+ManifestCache *Flight::manifests = nullptr;
+
 Flight::Flight(const std::string &id, int size) : id(id), size(size) {
-    seats = new Customer*[size];
-    memset(seats, 0, sizeof(Customer*) * size);
+    seats = new SeatMap(size);
+    freeSeats = new SeatAllocator(size);
+}
+
+Flight::~Flight() {
+    // key objects (seats is null) never render anything, so only real flights have to clean up after themselves
+    if (manifests && seats) manifests->forget(this, id);
+    delete seats; // works even if seats is still nullptr
+    delete freeSeats;
 }
 
 Flight& Flight::operator=(const Flight &rhs) {
+    if (manifests && seats) manifests->forget(this, id); // whatever we rendered is about to be out of date
     id = rhs.id;
     size = rhs.size;
 
-    delete[] seats; // works even if its already null
+    delete seats; // works even if its already null
     seats = nullptr;
+    delete freeSeats;
+    freeSeats = nullptr;
 
-    if (rhs.seats != nullptr) { // rhs actually has seat data
-        seats = new Customer*[size];
-        memcpy(seats, rhs.seats, sizeof(Customer*) * size);
+    if (rhs.seats != nullptr) { // rhs actually has seat data, only its occupied seats are copied if it is sparse
+        seats = new SeatMap(*rhs.seats);
+        freeSeats = new SeatAllocator(*rhs.freeSeats);
     }
 
     return *this;
@@ -34,55 +45,78 @@ Customer* Flight::getSeat(int i) const {
         std::cout << "Warning: attempted to access invalid seat index " << i << " on Flight of size " << size << std::endl;
         return nullptr;
     }
-    return seats[i];
+    return seats->get(i);
 }
 void Flight::setSeat(int i, Customer *c) {
     if (i < 0 || i >= size) { // bounds checking
         std::cout << "Warning: attempted to set invalid seat index " << i << " on Flight of size " << size << std::endl;
     }
-    else seats[i] = c;
+    else {
+        // the allocator only cares about seats going from free to taken or back
+        bool wasFree = seats->get(i) == nullptr;
+        if (wasFree && c) freeSeats->occupy(i);
+        else if (!wasFree && !c) freeSeats->free(i);
+
+        seats->set(i, c);
+        if (manifests) manifests->invalidate(id);
+    }
+}
+
+int Flight::findFreeSeats(int k, Fit fit) const {
+    return fit == FIRST_FIT ? freeSeats->firstFit(k) : freeSeats->bestFit(k);
 }
 
 // return -1 if less than, 0 if equal, 1 if greater than
 int Flight::compare(const Record *that) const {
-    const Flight *f = dynamic_cast<const Flight*>(that);
-    if (id < f->id) return -1;
-    else if (id > f->id) return 1;
-    else return 0;
+    const Flight *f = static_cast<const Flight*>(that); // see Customer::compare
+    int byId = id.compare(f->id);
+    return byId < 0 ? -1 : (byId > 0 ? 1 : 0);
 }
 
-void Flight::save(std::ofstream &fout) const {
-    writeString(fout, id);
-    writeInt(fout, size);
-}
-void Flight::load(std::ifstream &fin) {
-    id = readString(fin);
-    size = readInt(fin);
-    if (seats != nullptr) delete[] seats;
-    seats = new Customer*[size];
-    memset(seats, 0, sizeof(Customer*) * size);
+// now that we know the size, make room for the seats, which all start out unoccupied
+void RecordLayout<Flight>::loaded(Flight &f) {
+    delete f.seats;
+    f.seats = new SeatMap(f.size);
+    delete f.freeSeats;
+    f.freeSeats = new SeatAllocator(f.size);
 }
 
 // show each seat as either unoccupied or print occupant information
 std::string Flight::toString(bool showOccupiedOnly) const {
+    ManifestCache::View view = showOccupiedOnly ? ManifestCache::OCCUPIED_ONLY : ManifestCache::ALL_SEATS;
+    if (manifests) { // nothing changed since last time, so the same text can be given back
+        const std::string *cached = manifests->find(this, id, view);
+        if (cached) return *cached;
+    }
+
+    // only the occupied seats are visited, the empty ones in between are filled in if they are shown
     std::stringstream ss;
     ss << "Flight " << id << ": \n";
-    for (int i = 0; i < size; i++) {
-        if (seats[i] == nullptr && showOccupiedOnly) continue;
-        ss << "Seat " << i << ": ";
-        if (seats[i]) ss << seats[i]->toString() << '\n';
-        else ss << "Unoccupied\n";
-    }
-    return ss.str();
+    int next = 0; // first seat which hasn't been written yet
+    forEachPassenger([&](int seat, Customer *c) {
+        if (!showOccupiedOnly)
+            for (; next < seat; next++) ss << "Seat " << next << ": Unoccupied\n";
+        ss << "Seat " << seat << ": " << c->toString() << '\n';
+        next = seat + 1;
+    });
+    if (!showOccupiedOnly)
+        for (; next < size; next++) ss << "Seat " << next << ": Unoccupied\n";
+
+    std::string text = ss.str();
+    if (manifests) manifests->store(this, id, view, text);
+    return text;
 }
 
 // show all seats, but sort them in lexicographical order of passanger names
 std::string Flight::toSortedString() const {
-    Customer **tmp = new Customer*[size];
+    if (manifests) {
+        const std::string *cached = manifests->find(this, id, ManifestCache::SORTED_BY_NAME);
+        if (cached) return *cached;
+    }
+
+    Customer **tmp = new Customer*[seats->occupied()];
     int cnt = 0;
-    for (int i = 0; i < size; i++) // add and count only non-empty seats
-        if (seats[i])
-            tmp[cnt++] = seats[i];
+    forEachPassenger([&](int, Customer *c) { tmp[cnt++] = c; }); // only non-empty seats
 
     quickSort(tmp, 0, cnt - 1);
 
@@ -95,7 +129,9 @@ std::string Flight::toSortedString() const {
 
     delete[] tmp;
 
-    return ss.str();
+    std::string text = ss.str();
+    if (manifests) manifests->store(this, id, ManifestCache::SORTED_BY_NAME, text);
+    return text;
 }
 
 // a simple, recursive quickSort implementation
@@ -4,34 +4,53 @@
 #include <string>
 #include "Record.h"
 #include "Customer.h"
+#include "Serialization.h"
+#include "ManifestCache.h"
+#include "SeatMap.h"
+#include "SeatAllocator.h"
 
 class Flight : public Record {
+    friend struct RecordLayout<Flight>;
+    friend class Snapshot; // which reads the oldest database files field by field
 private:
     std::string id;
     int size = 0;
 
-    // seats is a dynamically-allocated array with each element being a pointer to a Customer class
-    // element seats[i] stores a pointer to the Customer object that occupies seat number i, or nullptr if that seat is unoccupied
+    // seats keeps track of which Customer occupies each seat, using as little memory as it can (see SeatMap.h)
+    // it is null for key objects, which are only used for comparisons
     // note that the Flight class does not 'own' these Customer objects, so we do not delete them in the destructor
-    Customer **seats = nullptr;
+    SeatMap *seats = nullptr;
+    SeatAllocator *freeSeats = nullptr; // runs of free seats, for picking seats automatically (see SeatAllocator.h)
 
     static void quickSort(Customer **arr, int lo, int hi); // private helper function to sort Customers
 public:
+    // when this is set, rendered manifests are kept in it until a seat changes (see ManifestCache.h)
+    static ManifestCache *manifests;
+
+    // how to pick among several runs of free seats which are all long enough:
+    // FIRST_FIT takes the lowest numbered one, BEST_FIT the shortest one (saving the longer runs for bigger groups)
+    enum Fit { FIRST_FIT, BEST_FIT };
+
     Flight(const std::string &id) : id(id) {}; // leaves seats uninitialized
     Flight(const std::string &id, int size);
-    ~Flight() { delete[] seats; /*works even if seats is still nullptr*/ } // 1 of 3
+    ~Flight(); // 1 of 3
     Flight& operator=(const Flight &rhs); // 2 of 3
     Flight(const Flight &f); // 3 of 3
 
     int compare(const Record *that) const override;
-    void save(std::ofstream &fout) const override;
-    void load(std::ifstream &fin) override;
-    Record* duplicateType() const override { return new Flight("arbitrary"); };
 
     inline int getSize() const { return size; }
+    inline int getOccupiedCount() const { return seats->occupied(); }
     Customer* getSeat(int i) const;
+    // runs func(seat number, occupant) for every occupied seat in increasing seat order, skipping the empty ones
+    template<class Func>
+    void forEachPassenger(Func func) const { seats->forEachOccupied(func); }
     inline std::string getId() const { return id; }
 
+    inline int getLongestFreeRun() const { return freeSeats->longestFreeRun(); }
+    // the first seat of k free seats in a row, or -1 if there is no such run
+    int findFreeSeats(int k, Fit fit) const;
+
     void setSeat(int i, Customer *c);
     // don't want setters for id or size
 
@@ -39,4 +58,13 @@ public:
     std::string toSortedString() const;
 };
 
+// what a Flight looks like on disk (see Serialization.h)
+// the seats aren't saved here since they are pointers, Snapshot saves which Customer sits where separately
+template<> struct RecordLayout<Flight> {
+    static constexpr auto keyFields() { return std::make_tuple(&Flight::id); }
+    static constexpr auto payloadFields() { return std::make_tuple(&Flight::size); }
+    static Flight* make() { return new Flight(""); }
+    static void loaded(Flight &f);
+};
+
 #endif // FLIGHT_H
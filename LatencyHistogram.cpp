@@ -0,0 +1,60 @@
+#include "LatencyHistogram.h"
+
+#include <cstdio>
+
+// times below SUB_BUCKETS get a bucket each, after that the bucket is picked by the
+// highest set bit (which power of two) and the next 3 bits (which eighth of it)
+int LatencyHistogram::bucketFor(long long ns) {
+    if (ns < SUB_BUCKETS) return ns < 0 ? 0 : static_cast<int>(ns);
+    int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(ns));
+    int sub = static_cast<int>(ns >> (exponent - 3)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (exponent - 3) * SUB_BUCKETS + sub;
+}
+
+long long LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int exponent = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 3;
+    long long sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::add(long long ns) {
+    counts[bucketFor(ns)]++;
+    total++;
+    sum += ns;
+    if (ns > largest) largest = ns;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (int i = 0; i < NUM_BUCKETS; i++) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    if (other.largest > largest) largest = other.largest;
+}
+
+void LatencyHistogram::clear() {
+    counts.fill(0);
+    total = sum = largest = 0;
+}
+
+long long LatencyHistogram::percentile(double p) const {
+    if (total == 0) return 0;
+    long long needed = static_cast<long long>(p / 100 * total + 0.5);
+    if (needed < 1) needed = 1;
+    long long seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= needed) {
+            long long bound = bucketUpperBound(i);
+            return bound < largest ? bound : largest; // nothing was slower than the max, even if the bucket goes past it
+        }
+    }
+    return largest;
+}
+
+std::string LatencyHistogram::summary() const {
+    char line[160];
+    snprintf(line, sizeof(line), "%8lld %10.1f %10.1f %10.1f %10.1f %10.1f",
+             total, mean() / 1000, percentile(50) / 1000.0, percentile(90) / 1000.0, percentile(99) / 1000.0, largest / 1000.0);
+    return line;
+}
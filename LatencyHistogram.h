@@ -0,0 +1,42 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <string>
+
+/*
+    Latency histogram
+
+    Keeping every measured time to work out percentiles would use more and more memory the longer we measure,
+    so instead times (in nanoseconds) are counted in buckets:
+    every power of two is split into SUB_BUCKETS equal buckets, so a bucket is never more than 1/8th (12.5%) wide
+    relative to the times in it, and the whole range of a long long fits in a few hundred counters.
+*/
+class LatencyHistogram {
+private:
+    static const int SUB_BUCKETS = 8;
+    static const int NUM_BUCKETS = SUB_BUCKETS + 61 * SUB_BUCKETS;
+
+    std::array<long long, NUM_BUCKETS> counts{};
+    long long total = 0, sum = 0, largest = 0;
+
+    static int bucketFor(long long ns);
+    static long long bucketUpperBound(int bucket);
+public:
+    // rule of three: nothing to free, copying is fine
+
+    void add(long long ns);
+    void merge(const LatencyHistogram &other);
+    void clear();
+
+    inline long long count() const { return total; }
+    inline long long max() const { return largest; }
+    inline double mean() const { return total == 0 ? 0 : static_cast<double>(sum) / total; }
+    // the time that p percent of the measurements were at most (rounded up to the end of its bucket)
+    long long percentile(double p) const;
+
+    // one line summary: count, mean and a few percentiles, in microseconds
+    std::string summary() const;
+};
+
+#endif // LATENCYHISTOGRAM_H
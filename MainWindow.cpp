@@ -4,12 +4,18 @@
 // because Qt auto-generates it during the build process
 // it contains internal Qt functions and data
 #include "ui_MainWindow.h"
+#include "Exporter.h"
 
 #include <QComboBox>
+#include <QFileDialog>
 #include <QMessageBox>
-#include <fstream>
+#include <QStatusBar>
+#include <QTextCursor>
+#include <QTimer>
+#include <cstdio>
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow) {
+// the database is loaded from data/data.dat by the worker, in the background
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow), worker("data/data.dat") {
     // do some Qt setup:
     ui->setupUi(this);
     this->setCentralWidget(ui->tabWidget);
@@ -18,13 +24,95 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
         findChild<QComboBox*>("flightSeatsEdit")->addItem(QString::number(i));
     }
 
-    loadDataBases();
+    // the timers belong to this window (their parent), so Qt deletes them for us
+    QTimer *diagnosticsTimer = new QTimer(this);
+    connect(diagnosticsTimer, &QTimer::timeout, this, &MainWindow::refreshDiagnostics);
+    diagnosticsTimer->start(1000);
+
+    manifestFeeder = new QTimer(this);
+    manifestFeeder->setInterval(0); // as often as possible, but only once all other events have been handled
+    connect(manifestFeeder, &QTimer::timeout, this, &MainWindow::showManifestChunk);
+
+    // if the database file can't be read, nothing gets saved, and the user needs to know that before changing anything
+    worker.post([](Database &db) { return QString::fromStdString(db.getLoadProblem()); }, [this](const QString &problem) {
+        if (!problem.isEmpty()) QMessageBox::warning(this, "Database", "Error: " + problem);
+    });
 }
 
 MainWindow::~MainWindow() {
     delete ui;
 }
 
+void MainWindow::startRecording(const QString &tracePath) {
+    std::string path = tracePath.toStdString();
+    worker.post([path](Database &db) { return db.startRecording(path); }, [this, tracePath](bool ok) {
+        statusBar()->showMessage(ok ? "Recording operations to " + tracePath : "Error: can't record to " + tracePath);
+    });
+}
+
+// the full diagnostics are only worked out while someone is looking at them, since measuring the trees visits every node
+// the statistics are read on the worker as well, since the histograms in Stats are only ever changed from there
+void MainWindow::refreshDiagnostics() {
+    bool showing = ui->tabWidget->currentWidget() == findChild<QWidget*>("diagnosticstab");
+    worker.postLatest(DatabaseWorker::DIAGNOSTICS, [showing](Database &db) {
+        std::pair<QString, QString> text; // (status bar summary, diagnostics tab)
+#ifdef AIRLINE_STATS
+        // a one line summary in the status bar, so it can be kept an eye on from the other tabs too
+        long long lookups = Stats::lookups;
+        text.first = QString("%1 lookups, %2 comparisons per lookup, %3 saves (%4 ms at p50)")
+                .arg(lookups).arg(lookups ? static_cast<double>(Stats::comparisons) / lookups : 0, 0, 'f', 1)
+                .arg(Stats::saves.count()).arg(Stats::saves.percentile(50) / 1e6, 0, 'f', 1);
+#endif
+        if (showing) text.second = QString::fromStdString(db.diagnostics().toText());
+        return text;
+    }, [this, showing](const std::pair<QString, QString> &text) {
+        if (!text.first.isEmpty()) statusBar()->showMessage(text.first);
+        if (showing) findChild<QPlainTextEdit*>("diagnosticsOutput")->setPlainText(text.second);
+    });
+}
+
+// asks where to put the export, the file type picks the format
+void MainWindow::on_actionExport_triggered() {
+    QString outPath = QFileDialog::getSaveFileName(this, "Export Database", "export.csv", "CSV (*.csv);;JSON (*.json)");
+    if (outPath.isEmpty()) return; // the user cancelled
+
+    // exported from the saved database file rather than from memory (see Exporter.h)
+    // the worker only pins the file as it is now, which is quick, and the export itself runs on Qt's global pool,
+    // so bookings go on while a big export is written
+    statusBar()->showMessage("Exporting to " + outPath + "...");
+    worker.post([](Database &db) { return db.pinSnapshot(); }, [this, outPath](const std::string &pinned) {
+        if (pinned.empty()) {
+            statusBar()->showMessage("Error: can't read the database file to export it");
+            return;
+        }
+        std::string path = outPath.toStdString();
+        QFutureWatcher<long long> *watcher = new QFutureWatcher<long long>(this); // deletes itself once finished
+        connect(watcher, &QFutureWatcher<long long>::finished, this, [this, watcher, outPath]() {
+            long long rows = watcher->result();
+            if (rows >= 0) statusBar()->showMessage(QString("Exported %1 flights and customers to %2").arg(rows).arg(outPath));
+            else statusBar()->showMessage("Error: can't export to " + outPath);
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([pinned, path]() {
+            long long rows;
+            bool ok = Exporter::exportSnapshot(pinned, path, Exporter::formatFor(path), rows);
+            std::remove(pinned.c_str()); // nothing else uses it
+            return ok ? rows : -1;
+        }));
+    });
+}
+
+// clears a line edit once its operation went through, unless the user has typed something else into it since
+static void clearIfUnchanged(QLineEdit *edit, const QString &submitted) {
+    if (edit->text().trimmed() == submitted) edit->clear();
+}
+
+// the message for a change which went through, with a warning when it is only in memory (see Database::DISK_ERROR)
+static QString changed(const QString &message, Database::Result result) {
+    if (result != Database::DISK_ERROR) return message;
+    return message + ", but the database file couldn't be saved";
+}
+
 // called when user attempts to add flight
 // checks for the validity of the operation (are all the required boxes filled? does the flight already exist?)
 void MainWindow::on_addFlightButton_released() {
@@ -37,16 +125,15 @@ void MainWindow::on_addFlightButton_released() {
         return;
     }
 
-    Flight *flight = new Flight(id.toStdString(), numSeats);
-    if (flights.contains(flight)) {
-        status->setText("Error: flight already exists");
-        delete flight;
-        return;
-    }
-    flights.insert(flight);
-    saveDataBases();
-    status->setText("Flight '" + id + "' successfully added");
-    findChild<QLineEdit*>("flightIdEdit")->clear();
+    std::string flightId = id.toStdString();
+    worker.post([flightId, numSeats](Database &db) { return db.addFlight(flightId, numSeats); }, [this, status, id](Database::Result result) {
+        if (result == Database::FLIGHT_EXISTS) {
+            status->setText("Error: flight already exists");
+            return;
+        }
+        status->setText(changed("Flight '" + id + "' successfully added", result));
+        clearIfUnchanged(findChild<QLineEdit*>("flightIdEdit"), id);
+    });
 }
 
 // called when user attempts to remove flight
@@ -60,24 +147,17 @@ void MainWindow::on_removeFlightButton_released() {
         return;
     }
 
-    // we can allocate this on the stack and use the constructor that leaves its heap memory uninitialized
-    // since it doesnt actually store anything, its used only to search the RBTree via comparisons
-    Flight key(id.toStdString()); // there will be more instances of objects used like this later on
-    if (!flights.contains(&key)) {
-        status->setText("Error: flight doesn't exist");
-        return;
-    }
-
-    // before erasing flight, remove all customers who booked this flight:
-    Flight *flight = dynamic_cast<Flight*>(flights.get(&key));
-    for (int i = 0; i < flight->getSize(); i++)
-        if (flight->getSeat(i) != nullptr)
-            customers.erase(flight->getSeat(i));
-
-    flights.erase(&key);
-    saveDataBases();
-    status->setText("Flight '" + id + "' successfully removed");
-    findChild<QLineEdit*>("rflightIdEdit")->clear();
+    // this also cancels the reservations of everyone booked on the flight, which can take a while
+    status->setText("Removing flight '" + id + "'...");
+    std::string flightId = id.toStdString();
+    worker.post([flightId](Database &db) { return db.removeFlight(flightId); }, [this, status, id](Database::Result result) {
+        if (result == Database::NO_FLIGHT) {
+            status->setText("Error: flight doesn't exist");
+            return;
+        }
+        status->setText(changed("Flight '" + id + "' successfully removed", result));
+        clearIfUnchanged(findChild<QLineEdit*>("rflightIdEdit"), id);
+    });
 }
 
 // called when user queries a flight
@@ -86,23 +166,68 @@ void MainWindow::on_queryFlightButton_released() {
     QPlainTextEdit *output = findChild<QPlainTextEdit*>("queryFlightOutput");
     QString id = findChild<QLineEdit*>("queryFlightIdEdit")->text().trimmed();
 
+    // whatever the previous query was still showing is out of date now
+    manifestFeeder->stop();
+    manifestText.clear();
     output->clear();
     if (id.isEmpty()) {
+        worker.cancel(DatabaseWorker::MANIFEST);
         output->appendPlainText("Error: FlightID is empty");
         return;
     }
 
-    Flight key(id.toStdString()); // another key object
-    if (!flights.contains(&key)) {
-        output->appendPlainText("Error: flight doesn't exist");
-        return;
-    }
-    if (!sortByName)
-        output->appendPlainText(QString::fromStdString(dynamic_cast<Flight*>(flights.get(&key))->toString(showOccupiedOnly)));
-    else
-        output->appendPlainText(QString::fromStdString(dynamic_cast<Flight*>(flights.get(&key))->toSortedString()));
+    // the manifest is formatted (and turned into a QString) on the worker, only a newer query can replace it
+    std::string flightId = id.toStdString();
+    bool occupiedOnly = showOccupiedOnly, sorted = sortByName;
+    worker.postLatest(DatabaseWorker::MANIFEST, [flightId, occupiedOnly, sorted](Database &db) {
+        // (manifest, manifest cache summary), the manifest is empty if there is no such flight, and then so is the summary
+        // unless it is the error to show instead
+        std::pair<QString, QString> text;
+        std::string manifest;
+        Database::Result result = db.queryFlight(flightId, occupiedOnly, sorted, manifest);
+        if (result == Database::NO_FLIGHT) return text;
+        if (result == Database::DISK_ERROR) {
+            text.second = "Error: some passengers' details couldn't be read from the database file";
+            return text;
+        }
+        text.first = QString::fromStdString(manifest);
+        const ManifestCache &manifests = db.manifests();
+        text.second = QString("Manifest cache: %1 hits, %2 misses, %3 KB")
+                .arg(manifests.hits()).arg(manifests.misses()).arg(manifests.bytesUsed() / 1024);
+        return text;
+    }, [this, output, id](const std::pair<QString, QString> &text) {
+        if (text.first.isEmpty()) {
+            output->appendPlainText(text.second.isEmpty() ? "Error: flight doesn't exist" : text.second);
+            return;
+        }
+        statusBar()->showMessage(text.second);
+        clearIfUnchanged(findChild<QLineEdit*>("queryFlightIdEdit"), id);
+
+        // adding a big manifest in one go would freeze the window, so it goes in a piece at a time (see showManifestChunk)
+        manifestText = text.first;
+        manifestShown = 0;
+        manifestFeeder->start();
+    });
+}
 
-    findChild<QLineEdit*>("queryFlightIdEdit")->clear();
+// adds the next part of the manifest to the output, small enough to take well under a frame,
+// then lets the window handle input and redraw before the next part
+void MainWindow::showManifestChunk() {
+    const int CHUNK = 16 * 1024; // characters
+    int end = manifestShown + CHUNK;
+    if (end < manifestText.size()) end = manifestText.indexOf('\n', end) + 1; // finish the line, 0 if it was the last one
+    if (end <= 0 || end > manifestText.size()) end = manifestText.size();
+
+    // a cursor of our own, so the view stays at the top instead of following the text
+    QTextCursor cursor(findChild<QPlainTextEdit*>("queryFlightOutput")->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(manifestText.mid(manifestShown, end - manifestShown));
+    manifestShown = end;
+
+    if (manifestShown >= manifestText.size()) {
+        manifestFeeder->stop();
+        manifestText.clear();
+    }
 }
 
 // called when checkbox for showing only occupied seats is changed
@@ -135,21 +260,6 @@ void MainWindow::on_addCustomerSubmit_released() {
         return;
     }
 
-    Flight key(flightId.toStdString()); // another key object
-    if (!flights.contains(&key)) {
-        status->setText("Error: flight doesn't exist");
-        return;
-    }
-    Flight *flight = dynamic_cast<Flight*>(flights.get(&key));
-    if (seatNum >= flight->getSize()) {
-        status->setText("Error: seat number can be at most " + QString::number(flight->getSize() - 1));
-        return;
-    }
-    if (flight->getSeat(seatNum) != nullptr) {
-        status->setText("Error: seat already taken");
-        return;
-    }
-
     QString name = findChild<QLineEdit*>("addCustomerName")->text().trimmed();
     QString address = findChild<QLineEdit*>("addCustomerAddress")->text().trimmed();
     QString phonenum = findChild<QLineEdit*>("addCustomerPhoneNum")->text().trimmed();
@@ -166,21 +276,51 @@ void MainWindow::on_addCustomerSubmit_released() {
         return;
     }
 
-    Customer *customer = new Customer(name.toStdString(), address.toStdString(), phonenum.toStdString(), flightId.toStdString(), seatNum);
-    if (customers.contains(customer)) {
-        status->setText("Error: customer already has reservation");
-        delete customer;
-        return;
-    }
-    customers.insert(customer);
-    flight->setSeat(seatNum, customer);
-    saveDataBases();
-    status->setText("Reservation successfully added");
-
-    findChild<QLineEdit*>("addCustomerFlightId")->clear();
-    findChild<QLineEdit*>("addCustomerName")->clear();
-    findChild<QLineEdit*>("addCustomerAddress")->clear();
-    findChild<QLineEdit*>("addCustomerPhoneNum")->clear();
+    // when picking automatically, the seat with the least free seats around it is used, keeping bigger gaps for groups
+    bool autoSeat = findChild<QCheckBox*>("addCustomerAutoSeat")->isChecked();
+    struct Booking {
+        Database::Result result = Database::OK;
+        int seatNum = -1, flightSize = 0; // the seat that was booked, and the flight's size for SEAT_OUT_OF_RANGE
+    };
+    std::string n = name.toStdString(), a = address.toStdString(), p = phonenum.toStdString(), f = flightId.toStdString();
+    worker.post([autoSeat, seatNum, n, a, p, f](Database &db) {
+        Booking booking;
+        booking.seatNum = seatNum;
+        booking.result = autoSeat ? db.bookAnySeat(n, a, p, f, booking.seatNum) : db.book(n, a, p, f, booking.seatNum);
+        if (booking.result == Database::SEAT_OUT_OF_RANGE) booking.flightSize = db.getFlight(f)->getSize();
+        return booking;
+    }, [this, status, flightId, name, address, phonenum](const Booking &booking) {
+        switch (booking.result) {
+        case Database::NO_FLIGHT:
+            status->setText("Error: flight doesn't exist");
+            return;
+        case Database::SEAT_OUT_OF_RANGE:
+            status->setText("Error: seat number can be at most " + QString::number(booking.flightSize - 1));
+            return;
+        case Database::SEAT_TAKEN:
+            status->setText("Error: seat already taken");
+            return;
+        case Database::CUSTOMER_EXISTS:
+            status->setText("Error: customer already has reservation");
+            return;
+        case Database::NO_ROOM:
+            status->setText("Error: flight is full");
+            return;
+        default:
+            break;
+        }
+        status->setText(changed("Reservation successfully added for Seat # " + QString::number(booking.seatNum), booking.result));
+
+        clearIfUnchanged(findChild<QLineEdit*>("addCustomerFlightId"), flightId);
+        clearIfUnchanged(findChild<QLineEdit*>("addCustomerName"), name);
+        clearIfUnchanged(findChild<QLineEdit*>("addCustomerAddress"), address);
+        clearIfUnchanged(findChild<QLineEdit*>("addCustomerPhoneNum"), phonenum);
+    });
+}
+
+// called when the checkbox for picking a seat automatically is changed
+void MainWindow::on_addCustomerAutoSeat_stateChanged(int arg1) {
+    findChild<QSpinBox*>("addCustomerSeatNum")->setEnabled(arg1 != Qt::Checked); // the seat number isn't used then
 }
 
 // called when user submits a query to find a customer's reservation
@@ -203,16 +343,25 @@ void MainWindow::on_findCustomerSubmit_released() {
     findChild<QLineEdit*>("findCustomerPhoneNum")->clear();
     status->clear();
 
-    Customer key(name.toStdString(), phonenum.toStdString()); // another key object
-    if (!customers.contains(&key)) {
-        status->setText(name + " has no reservation");
-    }
-    else {
-        Customer *customer = dynamic_cast<Customer*>(customers.get(&key)); // full customer info
-
-        // information about the customers reservation (QString::arg formats the string kinda like printf):
-        QString info = QString("Customer %1 has reserved Seat # %2 on flight %3\nWould you like to delete it?")
-                .arg(QString::fromStdString(customer->getName()), QString::number(customer->getSeatNum()), QString::fromStdString(customer->getFlightId()));
+    // what find said, with information about the customers reservation (QString::arg formats the string kinda like printf) if there is one
+    // it has to be copied out on the worker, the Customer itself may be gone by the time we get to show it
+    std::string n = name.toStdString(), p = phonenum.toStdString();
+    worker.post([n, p](Database &db) {
+        Customer *customer; // full customer info
+        Database::Result result = db.find(n, p, customer);
+        if (result != Database::OK) return std::make_pair(result, QString());
+        return std::make_pair(result, QString("Customer %1 has reserved Seat # %2 on flight %3\nWould you like to delete it?")
+                .arg(QString::fromStdString(customer->getName()), QString::number(customer->getSeatNum()), QString::fromStdString(customer->getFlightId())));
+    }, [this, status, name, n, p](const std::pair<Database::Result, QString> &found) {
+        if (found.first == Database::NO_CUSTOMER) {
+            status->setText(name + " has no reservation");
+            return;
+        }
+        if (found.first == Database::DISK_ERROR) {
+            status->setText("Error: " + name + "'s reservation couldn't be read from the database file");
+            return;
+        }
+        const QString &info = found.second;
 
         // prompt user with message box:
         QMessageBox mbox;
@@ -223,47 +372,39 @@ void MainWindow::on_findCustomerSubmit_released() {
         auto action = mbox.exec(); // does user want to delete or not?
 
         if (action == QMessageBox::Yes) { // user wants to delete the reservation
-            // we first need to find the flight that this customer is on and clear their seat
-            Flight key2(customer->getFlightId()); // another key object
-            Flight *flight = dynamic_cast<Flight*>(flights.get(&key2));
-            flight->setSeat(customer->getSeatNum(), nullptr);
-
-            customers.erase(customer);
-            saveDataBases();
-            status->setText("Reservation successfully deleted");
+            worker.post([n, p](Database &db) { return db.cancel(n, p); }, [status](Database::Result result) {
+                // somebody could have cancelled it while the box was open (e.g. a replayed trace), so check again
+                if (result == Database::NO_CUSTOMER) status->setText("Reservation was already deleted");
+                else status->setText(result == Database::OK ? "Reservation successfully deleted" : "Error: the database file couldn't be read or saved");
+            });
         }
-    }
+    });
 }
 
-// given a Record, cast it to a Customer and mark that Customer's seat as occupied
-void MainWindow::loadDataHelper(Record *r) {
-    Customer *customer = dynamic_cast<Customer*>(r);
-    Flight key(customer->getFlightId()); // another key object
-    Flight *flight = dynamic_cast<Flight*>(flights.get(&key));
-    flight->setSeat(customer->getSeatNum(), customer);
-}
-
-void MainWindow::loadDataBases() {
-    // load flights:
-    std::ifstream fin("data/data.dat", std::ios::binary); // open data file and specify that we are reading binary
-    if (!fin.good()) return; // return if the file doesnt exist
-
-    Flight tmp("whatever"); // an arbitrary Flight instance, doesnt store anything, ensures that RBTree::load creates the correct type
-    flights.load(fin, &tmp);
-
-    Customer tmp2; // an arbitrary Customer instance, doesnt store anything, ensures that RBTree::load creates the correct type
-    customers.load(fin, &tmp2);
-
-    // due to the difficulties of writing pointers to the disk, we do not save the 'seats' data member of the Flight class
-    // which means that at this point in the code, the flights dont contain the proper seating information
-    // we must go through all customers and update their corrosponding flight
-    // note: this weird notation is a lambda expression which is necessary in order to pass a non-static member function as an argument
-    customers.forEach([this](Record *r) { this->loadDataHelper(r); });
-}
-
-void MainWindow::saveDataBases() {
-    std::ofstream fout("data/data.dat", std::ios::binary); // open data file and specify that we are writing binary
-    // opening the data file automatically overwrites the existing content on disk
-    flights.save(fout);
-    customers.save(fout);
+void MainWindow::on_findCustomerSearchButton_released() {
+    QString query = findChild<QLineEdit*>("findCustomerName")->text().trimmed();
+    if (query.isEmpty()) {
+        worker.cancel(DatabaseWorker::NAME_SEARCH);
+        findChild<QLabel*>("findCustomerStatus")->setText("Error: customer name is empty");
+        return;
+    }
+    findChild<QLabel*>("findCustomerStatus")->clear();
+
+    // the name index does the actual searching (see NameIndex.h), so this stays fast with lots of customers
+    // one line per customer, their phone number can then be typed above to find or delete the reservation
+    std::string q = query.toStdString();
+    worker.postLatest(DatabaseWorker::NAME_SEARCH, [q](Database &db) {
+        QString text;
+        std::vector<Customer*> matches;
+        if (db.searchNames(q, 20, matches) == Database::DISK_ERROR)
+            return QString("Error: some customers' details couldn't be read from the database file");
+        for (Customer *c : matches) {
+            text += QString("%1  %2  flight %3 seat %4\n")
+                    .arg(QString::fromStdString(c->getName()), QString::fromStdString(c->getPhoneNumber()),
+                         QString::fromStdString(c->getFlightId()), QString::number(c->getSeatNum()));
+        }
+        return text;
+    }, [this](const QString &text) {
+        findChild<QPlainTextEdit*>("findCustomerMatches")->setPlainText(text.isEmpty() ? "No customers found" : text);
+    });
 }
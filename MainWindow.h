@@ -2,8 +2,8 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include "RBTree.h"
-#include "Flight.h"
+#include <QTimer>
+#include "DatabaseWorker.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -19,18 +19,27 @@ public:
     MainWindow& operator=(const MainWindow &rhs) = delete; // 2 of 3
     MainWindow(const MainWindow &mw) = delete; // 3 of 3
 
+    // write every operation the user does to a trace file, which the console program can replay (see OperationTrace.h)
+    // the status bar says whether the file could be created
+    void startRecording(const QString &tracePath);
+
 private:
     Ui::MainWindow *ui; // a special Qt class
 
-    RBTree flights, customers; // database objects
+    // flights and customers, saved in data/data.dat
+    // every operation on them runs on the worker's thread, and the slots below only show the results (see DatabaseWorker.h)
+    DatabaseWorker worker;
     bool showOccupiedOnly = false, sortByName = false; // flags for how flight information is printed
 
-    // helper functions for saving and loading the database objects:
-    void loadDataHelper(Record *r);
-    void loadDataBases();
-    void saveDataBases();
+    // a big manifest is shown a piece at a time, so the window doesn't freeze while it is added
+    QTimer *manifestFeeder; // owned by Qt, through its parent
+    QString manifestText; // what is left to show
+    int manifestShown = 0; // characters of manifestText already in the output
 
 private slots: // functions that Qt calls whenever a GUI event happens
+    void refreshDiagnostics(); // called every second by a timer
+    void showManifestChunk(); // called by manifestFeeder until the whole manifest is shown
+    void on_actionExport_triggered(); // File > Export...
     void on_addFlightButton_released();
     void on_removeFlightButton_released();
     void on_queryFlightButton_released();
@@ -38,6 +47,8 @@ private slots: // functions that Qt calls whenever a GUI event happens
     void on_cbSorted_stateChanged(int arg1);
 
     void on_addCustomerSubmit_released();
+    void on_addCustomerAutoSeat_stateChanged(int arg1);
     void on_findCustomerSubmit_released();
+    void on_findCustomerSearchButton_released();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,50 @@
+#include "ManifestCache.h"
+
+static const int NUM_VIEWS = 3;
+
+void ManifestCache::drop(std::map<std::pair<std::string, int>, std::list<Entry>::iterator>::iterator it) {
+    used -= it->second->text.size();
+    lru.erase(it->second);
+    entries.erase(it);
+}
+
+const std::string* ManifestCache::find(const Flight *owner, const std::string &flightId, View view) {
+    auto it = entries.find(std::make_pair(flightId, static_cast<int>(view)));
+    if (it == entries.end() || it->second->owner != owner) {
+        missCount++;
+        return nullptr;
+    }
+    hitCount++;
+    lru.splice(lru.begin(), lru, it->second); // move it to the front, the iterator stays valid
+    return &it->second->text;
+}
+
+void ManifestCache::store(const Flight *owner, const std::string &flightId, View view, const std::string &text) {
+    auto key = std::make_pair(flightId, static_cast<int>(view));
+    auto it = entries.find(key);
+    if (it != entries.end()) drop(it); // replace whatever was there before
+    if (text.size() > budget) return; // would push everything else out and still not fit
+
+    lru.push_front({flightId, view, owner, text});
+    entries[key] = lru.begin();
+    used += text.size();
+
+    while (used > budget) { // over budget, drop least recently used manifests
+        const Entry &last = lru.back();
+        drop(entries.find(std::make_pair(last.flightId, static_cast<int>(last.view))));
+    }
+}
+
+void ManifestCache::invalidate(const std::string &flightId) {
+    for (int view = 0; view < NUM_VIEWS; view++) {
+        auto it = entries.find(std::make_pair(flightId, view));
+        if (it != entries.end()) drop(it);
+    }
+}
+
+void ManifestCache::forget(const Flight *owner, const std::string &flightId) {
+    for (int view = 0; view < NUM_VIEWS; view++) {
+        auto it = entries.find(std::make_pair(flightId, view));
+        if (it != entries.end() && it->second->owner == owner) drop(it);
+    }
+}
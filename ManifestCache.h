@@ -0,0 +1,58 @@
+#ifndef MANIFESTCACHE_H
+#define MANIFESTCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+class Flight; // only used as an identity here, so the full definition isn't needed
+
+/*
+    Rendered manifest cache
+
+    Formatting a flight's manifest goes through every seat (and may even have to load customers from disk),
+    but busy flights get queried over and over while nothing on them changes.
+    So Flight keeps the text it rendered for each view here, and only renders it again once it is invalidated,
+    which happens whenever a seat on the flight changes (Flight::setSeat) or one of its passengers is edited.
+
+    The cache has a budget in bytes, and once the manifests in it go over, the least recently used ones are dropped.
+*/
+class ManifestCache {
+public:
+    enum View { ALL_SEATS, OCCUPIED_ONLY, SORTED_BY_NAME };
+
+private:
+    struct Entry {
+        std::string flightId;
+        View view;
+        const Flight *owner; // the Flight which rendered it, so a copy of that Flight is never handed the original's text
+        std::string text;
+    };
+    // front of the list is the most recently used manifest, back is the next one to be dropped
+    std::list<Entry> lru;
+    std::map<std::pair<std::string, int>, std::list<Entry>::iterator> entries; // (flight id, view) -> where it is in lru
+
+    size_t budget; // most bytes of text kept at once
+    size_t used = 0;
+    long long hitCount = 0, missCount = 0;
+
+    void drop(std::map<std::pair<std::string, int>, std::list<Entry>::iterator>::iterator it);
+
+public:
+    ManifestCache(size_t budget) : budget(budget) {}
+    // rule of three: nothing to free by hand, and there is no reason to copy a cache
+
+    // the cached text for this view of the flight, or nullptr if it has to be rendered again
+    const std::string* find(const Flight *owner, const std::string &flightId, View view);
+    void store(const Flight *owner, const std::string &flightId, View view, const std::string &text);
+
+    void invalidate(const std::string &flightId); // something on the flight changed, drop every view of it
+    void forget(const Flight *owner, const std::string &flightId); // owner is going away, drop what it rendered
+
+    inline long long hits() const { return hitCount; }
+    inline long long misses() const { return missCount; }
+    inline size_t bytesUsed() const { return used; }
+};
+
+#endif // MANIFESTCACHE_H
@@ -0,0 +1,225 @@
+#include "NameIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+std::string NameIndex::normalize(const std::string &name) {
+    std::string lower = name;
+    for (char &ch : lower) ch = std::tolower(static_cast<unsigned char>(ch));
+    return lower;
+}
+
+// padding with spaces gives the start and end of the name trigrams of their own, so short names still have some,
+// and misspellings at either end still leave most of them intact
+std::vector<uint32_t> NameIndex::trigrams(const std::string &normalized, bool padded) {
+    std::string s = padded ? "  " + normalized + " " : normalized;
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i + 3 <= s.size(); i++) {
+        grams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(s[i])) << 16
+                        | static_cast<uint32_t>(static_cast<unsigned char>(s[i + 1])) << 8
+                        | static_cast<unsigned char>(s[i + 2]));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end()); // every trigram only counts once
+    return grams;
+}
+
+// the usual dynamic programming edit distance, one row at a time,
+// giving up as soon as every entry in a row is over the limit (the rest can only be bigger)
+int NameIndex::editDistance(const std::string &a, const std::string &b, int limit) {
+    if (std::abs(static_cast<int>(a.size()) - static_cast<int>(b.size())) > limit) return limit + 1;
+    std::vector<int> previous(b.size() + 1), current(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) previous[j] = j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        current[0] = i;
+        int best = current[0];
+        for (size_t j = 1; j <= b.size(); j++) {
+            int substitute = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            current[j] = std::min(substitute, std::min(previous[j], current[j - 1]) + 1);
+            best = std::min(best, current[j]);
+        }
+        if (best > limit) return limit + 1;
+        previous.swap(current);
+    }
+    return std::min(previous[b.size()], limit + 1);
+}
+
+void NameIndex::addPostings(int id) {
+    for (uint32_t gram : trigrams(entries[id].name, true)) postings[gram].push_back(id);
+}
+
+void NameIndex::insert(Customer *c) {
+    std::string name = normalize(c->getName());
+    auto it = ids.find(name);
+    if (it != ids.end()) { // someone else already has this name
+        entries[it->second].customers.push_back(c);
+        return;
+    }
+    int id = entries.size();
+    entries.push_back({name, {c}});
+    ids.emplace(name, id);
+    addPostings(id);
+}
+
+void NameIndex::erase(Customer *c) {
+    auto it = ids.find(normalize(c->getName()));
+    if (it == ids.end()) return;
+    std::vector<Customer*> &customers = entries[it->second].customers;
+    auto position = std::find(customers.begin(), customers.end(), c);
+    if (position == customers.end()) return;
+    *position = customers.back(); // order doesn't matter, so fill the gap with the last one
+    customers.pop_back();
+
+    if (customers.empty()) { // nobody has this name anymore, its id stays in the postings until we renumber
+        ids.erase(it);
+        unused++;
+        if (unused > 64 && unused * 2 > static_cast<int>(entries.size())) renumber();
+    }
+}
+
+void NameIndex::clear() {
+    entries.clear();
+    ids.clear();
+    postings.clear();
+    hits.clear();
+    unused = 0;
+}
+
+void NameIndex::renumber() {
+    std::vector<Entry> old;
+    old.swap(entries);
+    postings.clear();
+    for (auto &name : ids) { // going through ids also puts the new ids in alphabetical order
+        entries.push_back(std::move(old[name.second]));
+        name.second = entries.size() - 1;
+        addPostings(name.second);
+    }
+    unused = 0;
+    hits.clear();
+}
+
+void NameIndex::collect(const std::vector<int> &matchIds, size_t k, std::vector<Customer*> &out) const {
+    for (int id : matchIds)
+        for (Customer *c : entries[id].customers) {
+            if (out.size() >= k) return;
+            out.push_back(c);
+        }
+}
+
+std::vector<Customer*> NameIndex::prefix(const std::string &query, size_t k) const {
+    std::string q = normalize(query);
+    std::vector<int> matchIds;
+    size_t found = 0;
+    // every name starting with q comes right at or after q in sorted order
+    for (auto it = ids.lower_bound(q); it != ids.end() && found < k && it->first.compare(0, q.size(), q) == 0; ++it) {
+        matchIds.push_back(it->second);
+        found += entries[it->second].customers.size();
+    }
+    std::vector<Customer*> out;
+    collect(matchIds, k, out);
+    return out;
+}
+
+std::vector<Customer*> NameIndex::substring(const std::string &query, size_t k) {
+    std::string q = normalize(query);
+    std::vector<int> matchIds;
+
+    if (q.size() < 3) { // too short to have a trigram, so just go through the names in order
+        size_t found = 0;
+        for (auto it = ids.begin(); it != ids.end() && found < k; ++it) {
+            if (it->first.find(q) == std::string::npos) continue;
+            matchIds.push_back(it->second);
+            found += entries[it->second].customers.size();
+        }
+    }
+    else {
+        // a name containing q must be in the postings of every trigram of q,
+        // so go through the shortest list and look each id up in the others (they're sorted)
+        std::vector<const std::vector<int>*> lists;
+        for (uint32_t gram : trigrams(q, false)) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) return {}; // no name has this trigram
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const std::vector<int> *a, const std::vector<int> *b) { return a->size() < b->size(); });
+
+        for (int id : *lists[0]) {
+            bool everywhere = true;
+            for (size_t i = 1; i < lists.size() && everywhere; i++)
+                everywhere = std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+            // the trigrams could be in a different order, so check the name itself too
+            if (everywhere && !entries[id].customers.empty() && entries[id].name.find(q) != std::string::npos)
+                matchIds.push_back(id);
+        }
+
+        // alphabetical order, only sorting as many as we need
+        auto byName = [this](int a, int b) { return entries[a].name < entries[b].name; };
+        size_t keep = std::min(matchIds.size(), k);
+        std::partial_sort(matchIds.begin(), matchIds.begin() + keep, matchIds.end(), byName);
+        matchIds.resize(keep);
+    }
+
+    std::vector<Customer*> out;
+    collect(matchIds, k, out);
+    return out;
+}
+
+std::vector<Customer*> NameIndex::fuzzy(const std::string &query, int maxDistance, size_t k) {
+    std::string q = normalize(query);
+    std::vector<uint32_t> grams = trigrams(q, true);
+    // every mistake changes at most 3 trigrams (the ones overlapping it), so a close enough name shares at least this many
+    int needed = static_cast<int>(grams.size()) - 3 * maxDistance;
+
+    hits.resize(entries.size(), 0);
+    std::vector<int> touched; // ids with a non-zero count, so only those have to be reset afterwards
+    if (needed < 1) { // a very short query with lots of mistakes, a match might not share any trigram, so check every name
+        for (auto &name : ids) touched.push_back(name.second);
+        needed = 0;
+    }
+    else {
+        for (uint32_t gram : grams) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) continue;
+            for (int id : it->second)
+                if (hits[id]++ == 0) touched.push_back(id);
+        }
+    }
+
+    std::vector<std::pair<int, int>> matches; // (distance, id)
+    for (int id : touched) {
+        if (hits[id] >= needed && !entries[id].customers.empty()) {
+            int distance = editDistance(entries[id].name, q, maxDistance);
+            if (distance <= maxDistance) matches.push_back(std::make_pair(distance, id));
+        }
+        hits[id] = 0;
+    }
+
+    // closest first, then alphabetical
+    auto closer = [this](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+        if (a.first != b.first) return a.first < b.first;
+        return entries[a.second].name < entries[b.second].name;
+    };
+    size_t keep = std::min(matches.size(), k);
+    std::partial_sort(matches.begin(), matches.begin() + keep, matches.end(), closer);
+
+    std::vector<int> matchIds;
+    for (size_t i = 0; i < keep; i++) matchIds.push_back(matches[i].second);
+    std::vector<Customer*> out;
+    collect(matchIds, k, out);
+    return out;
+}
+
+std::vector<Customer*> NameIndex::search(const std::string &query, size_t k) {
+    std::vector<Customer*> out = prefix(query, k);
+    auto add = [&out, k](const std::vector<Customer*> &more) {
+        for (Customer *c : more)
+            if (out.size() < k && std::find(out.begin(), out.end(), c) == out.end())
+                out.push_back(c);
+    };
+    if (out.size() < k) add(substring(query, k));
+    // one or two letters are already matched by plenty of names above, and misspelling them would match nearly everything
+    // short names get fewer mistakes for the same reason
+    if (out.size() < k && query.size() >= 3) add(fuzzy(query, query.size() <= 4 ? 1 : 2, k));
+    return out;
+}
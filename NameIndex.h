@@ -0,0 +1,71 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Customer.h"
+
+/*
+    Customer name index
+
+    The customers tree can only find someone from their exact name and full phone number.
+    This index sits next to it and finds customers from part of a name, or a misspelled one:
+    - prefix: names starting with the query
+    - substring: names containing the query anywhere
+    - fuzzy: names at most maxDistance single character insertions, deletions or substitutions away from the query
+    Matching ignores upper/lower case. Every search returns at most k customers.
+
+    Every distinct name gets an id. For prefixes the names are kept sorted (in a map, which works like a trie here:
+    all names starting with the same prefix are next to each other).
+    For the other two, every name is split into trigrams, the overlapping 3 letter pieces of it
+    ("anna" -> "  a", " an", "ann", "nna", "na "), and for every trigram we keep the ids of the names that contain it
+    (its postings). A name containing the query has every trigram of the query, and a name with d mistakes still shares
+    all but at most 3 * d of them, so only names sharing enough trigrams have to be looked at closely.
+    (A query so short that 3 * d is more than it has trigrams can't rule anything out this way, so every name is checked.)
+
+    Ids are handed out in increasing order, so postings stay sorted without any work.
+    When the last customer with a name is erased, its id is only marked as unused, and once more than half of
+    the ids are unused the whole index is renumbered, so erasing is cheap on average.
+*/
+class NameIndex {
+private:
+    struct Entry {
+        std::string name; // lower case
+        std::vector<Customer*> customers; // everyone with this name, empty once the id is unused
+    };
+    std::vector<Entry> entries; // indexed by id
+    std::map<std::string, int> ids; // name -> id, only names which are in use
+    std::unordered_map<uint32_t, std::vector<int>> postings; // trigram -> ids of names containing it, in increasing order
+    int unused = 0; // number of entries with no customers
+
+    std::vector<int> hits; // scratch space for counting shared trigrams, one per id
+
+    static std::string normalize(const std::string &name);
+    static std::vector<uint32_t> trigrams(const std::string &normalized, bool padded);
+    static int editDistance(const std::string &a, const std::string &b, int limit); // limit + 1 if it is more than limit
+
+    void addPostings(int id);
+    void renumber(); // drop unused ids
+    // appends customers of the given ids to out, until it holds k of them
+    void collect(const std::vector<int> &matchIds, size_t k, std::vector<Customer*> &out) const;
+
+public:
+    // rule of three: the containers take care of themselves, and Customers aren't owned by the index
+
+    void insert(Customer *c);
+    void erase(Customer *c); // must be called before c is deleted
+    void clear();
+    inline size_t size() const { return ids.size(); } // number of distinct names
+
+    std::vector<Customer*> prefix(const std::string &query, size_t k) const;
+    std::vector<Customer*> substring(const std::string &query, size_t k);
+    std::vector<Customer*> fuzzy(const std::string &query, int maxDistance, size_t k); // closest first
+
+    // what the search box uses: prefix matches first, then substring matches, then close misspellings
+    std::vector<Customer*> search(const std::string &query, size_t k);
+};
+
+#endif // NAMEINDEX_H
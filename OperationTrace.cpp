@@ -0,0 +1,153 @@
+#include "OperationTrace.h"
+
+#include <cstring>
+
+static const char MAGIC[4] = {'A', 'I', 'R', 'T'};
+// version 2 added BOOK_ANY_SEAT and BOOK_GROUP, version 3 added SEARCH_NAME, older traces can still be read
+static const unsigned char VERSION = 3;
+
+const char* Operation::typeName(Type type) {
+    switch (type) {
+    case ADD_FLIGHT: return "add-flight";
+    case REMOVE_FLIGHT: return "remove-flight";
+    case QUERY_FLIGHT: return "query-flight";
+    case BOOK: return "book";
+    case FIND: return "find";
+    case CANCEL: return "cancel";
+    case BOOK_ANY_SEAT: return "book-any-seat";
+    case BOOK_GROUP: return "book-group";
+    case SEARCH_NAME: return "search-name";
+    }
+    return "unknown";
+}
+
+TraceRecorder::TraceRecorder(const std::string &path) : fout(path, std::ios::binary), start(std::chrono::steady_clock::now()) {
+    w.reset(new ByteWriter(fout));
+    w->putBytes(MAGIC, 4);
+    w->putByte(VERSION);
+}
+
+void TraceRecorder::record(Operation op) {
+    op.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    w->putByte(op.type);
+    w->putVarint(op.time - lastTime);
+    lastTime = op.time;
+
+    switch (op.type) {
+    case Operation::ADD_FLIGHT:
+        encodeField(*w, op.flightId);
+        encodeField(*w, op.number);
+        break;
+    case Operation::REMOVE_FLIGHT:
+        encodeField(*w, op.flightId);
+        break;
+    case Operation::QUERY_FLIGHT:
+        encodeField(*w, op.flightId);
+        w->putByte(op.occupiedOnly | op.sortByName << 1);
+        break;
+    case Operation::BOOK:
+        encodeField(*w, op.flightId);
+        encodeField(*w, op.name);
+        encodeField(*w, op.address);
+        encodeField(*w, op.phonenum);
+        encodeField(*w, op.number);
+        break;
+    case Operation::FIND:
+    case Operation::CANCEL:
+        encodeField(*w, op.name);
+        encodeField(*w, op.phonenum);
+        break;
+    case Operation::BOOK_ANY_SEAT:
+        encodeField(*w, op.flightId);
+        encodeField(*w, op.name);
+        encodeField(*w, op.address);
+        encodeField(*w, op.phonenum);
+        break;
+    case Operation::BOOK_GROUP:
+        encodeField(*w, op.flightId);
+        w->putVarint(op.group.size());
+        for (const Passenger &p : op.group) {
+            encodeField(*w, p.name);
+            encodeField(*w, p.address);
+            encodeField(*w, p.phonenum);
+        }
+        break;
+    case Operation::SEARCH_NAME:
+        encodeField(*w, op.name);
+        encodeField(*w, op.number);
+        break;
+    }
+}
+
+TraceReader::TraceReader(const std::string &path) : fin(path, std::ios::binary) {
+    if (!fin.good()) return;
+    r.reset(new ByteReader(fin));
+    char magic[4];
+    r->getBytes(magic, 4);
+    unsigned char version = r->getByte();
+    valid = memcmp(magic, MAGIC, 4) == 0 && version >= 1 && version <= VERSION && r->good();
+}
+
+bool TraceReader::next(Operation &op) {
+    if (!valid) return false;
+    unsigned char type = r->getByte();
+    if (!r->good() || type < Operation::ADD_FLIGHT || type >= Operation::NUM_TYPES) return false;
+
+    op = Operation();
+    op.type = static_cast<Operation::Type>(type);
+    lastTime += r->getVarint();
+    op.time = lastTime;
+
+    switch (op.type) {
+    case Operation::ADD_FLIGHT:
+        decodeField(*r, op.flightId);
+        decodeField(*r, op.number);
+        break;
+    case Operation::REMOVE_FLIGHT:
+        decodeField(*r, op.flightId);
+        break;
+    case Operation::QUERY_FLIGHT: {
+        decodeField(*r, op.flightId);
+        unsigned char flags = r->getByte();
+        op.occupiedOnly = flags & 1;
+        op.sortByName = flags & 2;
+        break;
+    }
+    case Operation::BOOK:
+        decodeField(*r, op.flightId);
+        decodeField(*r, op.name);
+        decodeField(*r, op.address);
+        decodeField(*r, op.phonenum);
+        decodeField(*r, op.number);
+        break;
+    case Operation::FIND:
+    case Operation::CANCEL:
+        decodeField(*r, op.name);
+        decodeField(*r, op.phonenum);
+        break;
+    case Operation::BOOK_ANY_SEAT:
+        decodeField(*r, op.flightId);
+        decodeField(*r, op.name);
+        decodeField(*r, op.address);
+        decodeField(*r, op.phonenum);
+        break;
+    case Operation::BOOK_GROUP: {
+        decodeField(*r, op.flightId);
+        // read one at a time rather than trusting the count up front, in case the trace was cut off
+        unsigned long long count = r->getVarint();
+        for (unsigned long long i = 0; i < count && r->good(); i++) {
+            Passenger p;
+            decodeField(*r, p.name);
+            decodeField(*r, p.address);
+            decodeField(*r, p.phonenum);
+            op.group.push_back(p);
+        }
+        break;
+    }
+    case Operation::SEARCH_NAME:
+        decodeField(*r, op.name);
+        decodeField(*r, op.number);
+        break;
+    }
+    return r->good(); // a trace cut off part way through an operation (the program crashed) just ends early
+}
@@ -0,0 +1,69 @@
+#ifndef OPERATIONTRACE_H
+#define OPERATIONTRACE_H
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Customer.h"
+#include "Serialization.h"
+
+/*
+    Operation traces
+
+    While recording, every logical operation the Database is asked to do (see Database.h) is appended to a trace file,
+    along with when it happened, so that the same workload can be replayed later without the GUI (see cli/Replay.cpp).
+
+    layout (numbers are varints, strings are a varint length followed by the characters, see Serialization.h):
+    - a 4 byte magic string followed by a version byte
+    - every operation, one after the other:
+        its type (one byte)
+        microseconds since the previous operation (or since recording started, for the first one)
+        the fields that type uses, in the order they are declared in Operation
+*/
+struct Operation {
+    enum Type : unsigned char { ADD_FLIGHT = 1, REMOVE_FLIGHT, QUERY_FLIGHT, BOOK, FIND, CANCEL, BOOK_ANY_SEAT, BOOK_GROUP, SEARCH_NAME };
+    static const int NUM_TYPES = SEARCH_NAME + 1;
+    static const char* typeName(Type type);
+
+    Type type = ADD_FLIGHT;
+    long long time = 0; // microseconds since recording started
+
+    std::string flightId; // every type except FIND, CANCEL and SEARCH_NAME
+    std::string name, address, phonenum; // BOOK, BOOK_ANY_SEAT, FIND and CANCEL (address only for the bookings), SEARCH_NAME only uses name
+    int number = 0; // number of seats for ADD_FLIGHT, seat number for BOOK, most results for SEARCH_NAME
+    bool occupiedOnly = false, sortByName = false; // QUERY_FLIGHT
+    std::vector<Passenger> group; // BOOK_GROUP, written as the number of passengers followed by each of them
+};
+
+// appends Operations to a trace file
+class TraceRecorder {
+private:
+    std::ofstream fout;
+    std::unique_ptr<ByteWriter> w;
+    std::chrono::steady_clock::time_point start;
+    long long lastTime = 0;
+public:
+    explicit TraceRecorder(const std::string &path);
+    // rule of three: the writer finishes the file when it is destroyed, and the ofstream can't be copied anyway
+
+    inline bool good() const { return fout.good(); }
+    void record(Operation op); // op.time is filled in here
+};
+
+// reads the Operations back out of a trace file, in order
+class TraceReader {
+private:
+    std::ifstream fin;
+    std::unique_ptr<ByteReader> r;
+    long long lastTime = 0;
+    bool valid = false;
+public:
+    explicit TraceReader(const std::string &path);
+
+    inline bool good() const { return valid; } // false if the file is missing or isn't a trace
+    bool next(Operation &op); // false once there are no more operations
+};
+
+#endif // OPERATIONTRACE_H
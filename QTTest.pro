@@ -1,8 +1,11 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
+CONFIG += c++17
+
+# "qmake CONFIG+=stats" compiles in the counters and timers from Stats.h
+stats: DEFINES += AIRLINE_STATS
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -10,21 +13,47 @@ CONFIG += c++11
 
 SOURCES += \
     Customer.cpp \
-    EasySaveLoad.cpp \
+    CustomerCache.cpp \
+    Database.cpp \
+    DatabaseWorker.cpp \
+    Exporter.cpp \
     Flight.cpp \
+    LatencyHistogram.cpp \
     MainWindow.cpp \
+    ManifestCache.cpp \
+    NameIndex.cpp \
+    OperationTrace.cpp \
     RBNode.cpp \
     RBTree.cpp \
+    SeatAllocator.cpp \
+    SeatMap.cpp \
+    Serialization.cpp \
+    ShardedCustomerStore.cpp \
+    Snapshot.cpp \
+    Stats.cpp \
     main.cpp
 
 HEADERS += \
     Customer.h \
-    EasySaveLoad.h \
+    CustomerCache.h \
+    Database.h \
+    DatabaseWorker.h \
+    Exporter.h \
     Flight.h \
+    LatencyHistogram.h \
     MainWindow.h \
+    ManifestCache.h \
+    NameIndex.h \
+    OperationTrace.h \
     RBNode.h \
     RBTree.h \
-    Record.h
+    Record.h \
+    SeatAllocator.h \
+    SeatMap.h \
+    Serialization.h \
+    ShardedCustomerStore.h \
+    Snapshot.h \
+    Stats.h
 
 FORMS += \
     MainWindow.ui
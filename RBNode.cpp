@@ -1,24 +1,24 @@
 #include "RBNode.h"
 
-const int8_t RBNode::BLACK = 0;
-const int8_t RBNode::RED = 1;
+#include <algorithm>
 
 RBNode::~RBNode() { // delete left and right children as well as data
     // this works fine even if any of these pointers are null
     // c++ standard guarantees delete is ignored if the argument is null
-    delete left;
+    delete left();
     delete right;
     delete data;
+    STATS_COUNT(nodesFreed);
 }
 
 void RBNode::flipColours() {
-    colour ^= 1; // xoring with one flips between 0 (BLACK) and 1 (RED)
-    left->colour ^= 1;
-    right->colour ^= 1;
+    leftAndColour ^= 1; // xoring with one flips between 0 (BLACK) and 1 (RED)
+    left()->leftAndColour ^= 1;
+    right->leftAndColour ^= 1;
 }
 bool RBNode::isRed(RBNode *node) {
     if (!node) return false; // in red-black trees, null nodes are considered black
-    return node->colour == RED;
+    return node->colour() == RED;
 }
 
 // make a right-leaning link lean to the left
@@ -27,46 +27,46 @@ bool RBNode::isRed(RBNode *node) {
 // rotation visualized: https://www.codesdope.com/staticroot/images/ds/rb14.gif
 RBNode* RBNode::rotateLeft(RBNode *h) {
     RBNode *x = h->right;
-    h->right = x->left;
-    x->left = h;
-    x->colour = h->colour;
-    h->colour = RED;
+    h->right = x->left();
+    x->setLeft(h);
+    x->setColour(h->colour());
+    h->setColour(RED);
     return x;
 }
 // make a left-leaning link lean to the right
 RBNode* RBNode::rotateRight(RBNode *h) {
-    RBNode *x = h->left;
-    h->left = x->right;
+    RBNode *x = h->left();
+    h->setLeft(x->right);
     x->right = h;
-    x->colour = h->colour;
-    h->colour = RED;
+    x->setColour(h->colour());
+    h->setColour(RED);
     return x;
 }
 
 // restore red-black tree invariant
 RBNode* RBNode::balance(RBNode *h) {
     if (isRed(h->right)) h = rotateLeft(h);
-    if (isRed(h->left) && isRed(h->left->left)) h = rotateRight(h);
-    if (isRed(h->left) && isRed(h->right)) h->flipColours();
+    if (isRed(h->left()) && isRed(h->left()->left())) h = rotateRight(h);
+    if (isRed(h->left()) && isRed(h->right)) h->flipColours();
     return h;
 }
 
-// assuming that h is red and both h->left and h->left->left
-// are black, make h->left or one of its children red
+// assuming that h is red and both h->left() and h->left()->left()
+// are black, make h->left() or one of its children red
 RBNode* RBNode::moveRedLeft(RBNode *h) {
     h->flipColours();
-    if (isRed(h->right->left)) {
+    if (isRed(h->right->left())) {
         h->right = rotateRight(h->right);
         h = rotateLeft(h);
         h->flipColours();
     }
     return h;
 }
-// assuming that h is red and both h->right and h->right->left
+// assuming that h is red and both h->right and h->right->left()
 // are black, make h->right or one of its children red
 RBNode* RBNode::moveRedRight(RBNode *h) {
     h->flipColours();
-    if (isRed(h->left->left)) {
+    if (isRed(h->left()->left())) {
         h = rotateRight(h);
         h->flipColours();
     }
@@ -74,37 +74,44 @@ RBNode* RBNode::moveRedRight(RBNode *h) {
 }
 
 // insert Record into red-back tree, does nothing if record already exists
-RBNode* RBNode::insert(RBNode *h, Record *data) {
-    if (h == nullptr) return new RBNode(data, RED); // recursion base case
+RBNode* RBNode::insert(RBNode *h, Record *data, bool &added) {
+    if (h == nullptr) { // recursion base case
+        added = true;
+        return new RBNode(data, RED);
+    }
     
+    STATS_COUNT(comparisons);
     int comp = data->compare(h->data);
-    if (comp < 0) h->left = insert(h->left, data); // bst: smaller values are to the left
-    else if (comp > 0) h->right = insert(h->right, data); // bst: larger values are to the right
+    if (comp < 0) h->setLeft(insert(h->left(), data, added)); // bst: smaller values are to the left
+    else if (comp > 0) h->right = insert(h->right, data, added); // bst: larger values are to the right
     // else: this current node contains target key
 
     // insertion may have broken invariant tree, so restore invariant:
-    if (isRed(h->right) && !isRed(h->left)) h = rotateLeft(h);
-    if (isRed(h->left) && isRed(h->left->left)) h = rotateRight(h);
-    if (isRed(h->left) && isRed(h->right)) h->flipColours();
+    if (isRed(h->right) && !isRed(h->left())) h = rotateLeft(h);
+    if (isRed(h->left()) && isRed(h->left()->left())) h = rotateRight(h);
+    if (isRed(h->left()) && isRed(h->right)) h->flipColours();
 
     return h;
 }
 
 // erase Record from red-black tree, record must exist (that check is performed in RBTree)
 RBNode* RBNode::erase(RBNode *h, Record *data) {
+    STATS_COUNT(comparisons);
     if (data->compare(h->data) < 0) { // bst: smaller values are to the left
-        if (!isRed(h->left) && !isRed(h->left->left))
+        if (!isRed(h->left()) && !isRed(h->left()->left()))
             h = moveRedLeft(h);
-        h->left = erase(h->left, data);
+        h->setLeft(erase(h->left(), data));
     }
     else {
-        if (isRed(h->left)) h = rotateRight(h);
+        if (isRed(h->left())) h = rotateRight(h);
+        STATS_COUNT(comparisons);
         if (data->compare(h->data) == 0 && h->right == nullptr) {
             delete h; // h is the node to delete, and there are no children larger than it (h->right is null)
             return nullptr; // node h has been deleted, so its parent marks it as null
         }
-        if (!isRed(h->right) && !isRed(h->right->left))
+        if (!isRed(h->right) && !isRed(h->right->left()))
             h = moveRedRight(h);
+        STATS_COUNT(comparisons);
         if (data->compare(h->data) == 0) { // matching key found
             // problem reduced to erasing the minimum from right subtree
             // and then having h, the target, assume the identity of the removed node
@@ -127,54 +134,203 @@ RBNode* RBNode::erase(RBNode *h, Record *data) {
 // contains only enough data to compare with other Records
 RBNode* RBNode::find(RBNode *h, Record *data) {
     if (h == nullptr) return nullptr;
+    STATS_COUNT(comparisons);
     int comp = data->compare(h->data);
     if (comp == 0) return h;
-    if (comp < 0) return find(h->left, data); // bst: smaller values are to the left
+    if (comp < 0) return find(h->left(), data); // bst: smaller values are to the left
     else return find(h->right, data); // bst: larger values are to the right
 }
 
 // returns Node with smallest Record in subtree rooted at h
 RBNode* RBNode::findMin(RBNode *h) {
-    if (h->left == nullptr) return h;
-    return findMin(h->left);
+    if (h->left() == nullptr) return h;
+    return findMin(h->left());
 }
 
 // erases Node with smallest Record in subtree rooted at h
 RBNode* RBNode::eraseMin(RBNode *h) {
-    if (h->left == nullptr) { // recursion base case
+    if (h->left() == nullptr) { // recursion base case
         delete h;
         return nullptr;
     }
-    if (!isRed(h->left) && !isRed(h->left->left)) // prepare tree for traversal
+    if (!isRed(h->left()) && !isRed(h->left()->left())) // prepare tree for traversal
         h = moveRedLeft(h);
-    h->left = eraseMin(h->left); // continued recursive traversal
+    h->setLeft(eraseMin(h->left())); // continued recursive traversal
     return balance(h); // restore invariant
 }
 
-void RBNode::save(std::ofstream &fout) const {
-    writeByte(fout, colour);
-    data->save(fout);
-    writeByte(fout, left != nullptr); // is there a left child?
-    if (left != nullptr) left->save(fout);
-    writeByte(fout, right != nullptr); // is there a right child?
-    if (right != nullptr) right->save(fout);
+RBNode* RBNode::detachMin(RBNode *h, RBNode *&min) {
+    if (h->left() == nullptr) { // recursion base case, h has no right child either
+        min = h;
+        return nullptr;
+    }
+    if (!isRed(h->left()) && !isRed(h->left()->left()))
+        h = moveRedLeft(h);
+    h->setLeft(detachMin(h->left(), min));
+    return balance(h);
+}
+
+int RBNode::blackHeight(RBNode *h) {
+    int height = 0;
+    for (; h != nullptr; h = h->left()) // every path has the same number of black nodes, so any path will do
+        if (!isRed(h)) height++;
+    return height;
+}
+
+// the nodes down the right side of a tree are all black (red links only lean left),
+// so we go down it until we reach the height of right, and put mid there as a red node with the rest of left below it
+// the red link is then fixed on the way back up exactly like after an insert
+RBNode* RBNode::joinRight(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight) {
+    if (leftHeight == rightHeight) {
+        mid->setLeft(left);
+        mid->right = right;
+        mid->setColour(RED);
+        return mid;
+    }
+    left->right = joinRight(left->right, leftHeight - 1, mid, right, rightHeight);
+
+    if (isRed(left->right) && !isRed(left->left())) left = rotateLeft(left);
+    if (isRed(left->left()) && isRed(left->left()->left())) left = rotateRight(left);
+    if (isRed(left->left()) && isRed(left->right)) left->flipColours();
+    return left;
+}
+
+// the same thing down the left side of right, which can have red nodes on it, so we stop at a black one
+RBNode* RBNode::joinLeft(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight) {
+    if (leftHeight == rightHeight && !isRed(right)) {
+        mid->setLeft(left);
+        mid->right = right;
+        mid->setColour(RED);
+        return mid;
+    }
+    right->setLeft(joinLeft(left, leftHeight, mid, right->left(), isRed(right) ? rightHeight : rightHeight - 1));
+
+    if (isRed(right->right) && !isRed(right->left())) right = rotateLeft(right);
+    if (isRed(right->left()) && isRed(right->left()->left())) right = rotateRight(right);
+    if (isRed(right->left()) && isRed(right->right)) right->flipColours();
+    return right;
+}
+
+RBNode* RBNode::join(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight, int &height) {
+    RBNode *h = leftHeight >= rightHeight ? joinRight(left, leftHeight, mid, right, rightHeight)
+                                          : joinLeft(left, leftHeight, mid, right, rightHeight);
+    height = std::max(leftHeight, rightHeight);
+    if (isRed(h)) { // a red root can always be made black, which adds one to every path
+        h->setColour(BLACK);
+        height++;
+    }
+    return h;
 }
 
-void RBNode::load(std::ifstream &fin, Record *type) {
-    colour = readByte(fin);
-    data->load(fin);
-    if (readByte(fin)) { // has left child
-        left = new RBNode(type->duplicateType(), 0);
-        left->load(fin, type);
+// h is taken apart into its left child, itself and its right child, the keys are shared out between the two children,
+// and the results are joined back together, with h in between unless it was one of the keys
+// subtrees without any keys in them are never even looked at, so this follows just one path for every key
+RBNode* RBNode::eraseAll(RBNode *h, int height, Record **keys, int n, int &newHeight, int &erased) {
+    newHeight = height;
+    if (h == nullptr || n == 0) return h; // recursion base case
+
+    // h's children become roots of their own, so a red left child turns black (right children are always black)
+    RBNode *left = h->left(), *right = h->right;
+    int leftHeight = height - 1, rightHeight = height - 1;
+    if (isRed(left)) {
+        left->setColour(BLACK);
+        leftHeight++;
     }
-    if (readByte(fin)) { // has right child
-        right = new RBNode(type->duplicateType(), 0);
-        right->load(fin, type);
+    h->setLeft(nullptr);
+    h->right = nullptr;
+
+    Record **middle = std::lower_bound(keys, keys + n, h->data, [](Record *key, Record *data) {
+        STATS_COUNT(comparisons);
+        return key->compare(data) < 0;
+    });
+    int smaller = middle - keys;
+    STATS_COUNT(comparisons);
+    bool found = smaller < n && keys[smaller]->compare(h->data) == 0;
+    int larger = smaller + (found ? 1 : 0);
+    left = eraseAll(left, leftHeight, keys, smaller, leftHeight, erased);
+    right = eraseAll(right, rightHeight, keys + larger, n - larger, rightHeight, erased);
+    if (!found) return join(left, leftHeight, h, right, rightHeight, newHeight);
+
+    // keys[smaller] might be h's own Record, which is why h is only deleted once every other key has been looked at
+    delete h; // its children were already detached, so this only deletes h and its Record
+    erased++;
+    if (right == nullptr) {
+        newHeight = leftHeight;
+        return left;
     }
+    // there is nothing left in between the two sides, so the smallest node on the right goes there instead
+    RBNode *min;
+    if (!isRed(right->left())) right->setColour(RED); // same special case as RBTree::erase, right->right is always black
+    right = detachMin(right, min);
+    if (right != nullptr) right->setColour(BLACK);
+    return join(left, leftHeight, min, right, blackHeight(right), newHeight);
+}
+
+// the largest black height a tree of n nodes can have: a tree with black height b needs at least 2^b - 1 nodes
+int RBNode::blackHeightFor(int n) {
+    int b = 0;
+    while ((2LL << b) - 1 <= n) b++; // long long, since 2^31 doesn't fit in an int
+    return b;
+}
+
+// think of the red-black tree as a 2-3 tree: a black node on its own is a '2-node' holding one key,
+// and a black node with a red left child is a '3-node' holding two keys
+// a subtree with black height b holds between 2^b - 1 (all 2-nodes) and 3^b - 1 (all 3-nodes) keys
+// so we decide whether the root is a 2-node or a 3-node depending on whether the keys fit under a 2-node,
+// then split the remaining keys as evenly as possible between its children (an even split always fits)
+RBNode* RBNode::buildSorted(RBNode **sorted, int n, int blackHeight) {
+    if (n == 0) return nullptr; // recursion base case, blackHeight is 0 here as well
+
+    // most keys a child subtree (black height blackHeight - 1) can hold: 3^(blackHeight - 1) - 1
+    // this overflows an int long before blackHeight gets big, so we stop multiplying once it is more than n anyway
+    long long most = 1;
+    for (int i = 1; i < blackHeight && most <= n; i++) most *= 3;
+    most -= 1;
+
+    if (n - 1 <= 2 * most) { // 2-node: [left subtree] key [right subtree]
+        int leftCount = (n - 1) / 2;
+        RBNode *h = sorted[leftCount];
+        h->setColour(BLACK);
+        h->setLeft(buildSorted(sorted, leftCount, blackHeight - 1));
+        h->right = buildSorted(sorted + leftCount + 1, n - 1 - leftCount, blackHeight - 1);
+        return h;
+    }
+    // 3-node: [a] key1 [b] key2 [c], where key1 is the red left child of key2
+    int a = (n - 2) / 3, b = (n - 2 - a) / 2, c = n - 2 - a - b;
+    RBNode *red = sorted[a];
+    red->setColour(RED);
+    red->setLeft(buildSorted(sorted, a, blackHeight - 1));
+    red->right = buildSorted(sorted + a + 1, b, blackHeight - 1);
+    RBNode *h = sorted[a + b + 1];
+    h->setColour(BLACK);
+    h->setLeft(red);
+    h->right = buildSorted(sorted + a + b + 2, c, blackHeight - 1);
+    return h;
+}
+
+void RBNode::collect(RBNode *h, std::vector<RBNode*> &out) {
+    if (h == nullptr) return;
+    collect(h->left(), out);
+    RBNode *right = h->right;
+    h->setLeft(nullptr);
+    h->right = nullptr; // detach so that deleting this node later doesn't delete the others
+    out.push_back(h);
+    collect(right, out);
+}
+
+int RBNode::checkInvariant(RBNode *h, const Record *low, const Record *high, bool parentRed) {
+    if (h == nullptr) return 0;
+    if (low && low->compare(h->data) >= 0) return -1; // out of order
+    if (high && h->data->compare(high) >= 0) return -1;
+    if (isRed(h) && parentRed) return -1; // two reds in a row
+    if (isRed(h->right)) return -1; // red links always lean left
+    int left = checkInvariant(h->left(), low, h->data, isRed(h));
+    int right = checkInvariant(h->right, h->data, high, isRed(h));
+    if (left == -1 || right == -1 || left != right) return -1; // different black heights
+    return left + (isRed(h) ? 0 : 1);
 }
 
-void RBNode::forEach(const std::function<void(Record*)> &func) {
-    if (left) left->forEach(func); // if left child isnt null, run theirs
-    func(data); // call func with our data
-    if (right) right->forEach(func); // if right child isnt null, run theirs
+int RBNode::height(RBNode *h) {
+    if (h == nullptr) return 0;
+    return 1 + std::max(height(h->left()), height(h->right));
 }
@@ -1,28 +1,41 @@
 #ifndef RBNODE_H
 #define RBNODE_H
 
+#include <cstdint>
 #include <cstdlib>
-#include <fstream>
-#include <functional>
+#include <vector>
 #include "Record.h"
-#include "EasySaveLoad.h"
 
-class RBNode : public EasySaveLoad {
+/*
+    Node layout
+
+    There can be millions of nodes, so they are kept as small as possible: just the three pointers, 24 bytes.
+    RBNode has no virtual functions (so no hidden vtable pointer), and the colour doesn't get a member of its own:
+    nodes are allocated at addresses which are multiples of 8, so the lowest bit of a pointer to one is always 0,
+    and we store the colour in that bit of the left child pointer instead.
+    left() and colour() pull the two apart again, which is why the left child is never accessed directly.
+*/
+class RBNode {
     friend class RBTree; // only allow RBTree to access these complicated functions
 private: // even the constructors are private since this class should only be used by RBTree
     Record *data;
-    RBNode *left = nullptr, *right = nullptr;
-    int8_t colour;
+    uintptr_t leftAndColour; // address of the left child, with the colour in the lowest bit
+    RBNode *right = nullptr;
 
-    static const int8_t BLACK, RED; // constants for the two different colours
+    static const bool BLACK = false, RED = true; // constants for the two different colours
 
-    RBNode(Record *data, int8_t colour) : data(data), colour(colour) {}
+    RBNode(Record *data, bool colour) : data(data), leftAndColour(colour) { STATS_COUNT(nodesAllocated); }
     ~RBNode(); // 1 of 3
 
     // to avoid unwanted and possibly dangerous behaviour, disallow these:
     RBNode& operator=(const RBNode &rhs) = delete; // 2 of 3
     RBNode(const RBNode &rhs) = delete; // 3 of 3
 
+    inline RBNode* left() const { return reinterpret_cast<RBNode*>(leftAndColour & ~static_cast<uintptr_t>(1)); }
+    inline void setLeft(RBNode *node) { leftAndColour = reinterpret_cast<uintptr_t>(node) | (leftAndColour & 1); }
+    inline bool colour() const { return leftAndColour & 1; }
+    inline void setColour(bool c) { leftAndColour = (leftAndColour & ~static_cast<uintptr_t>(1)) | c; }
+
     // helper functions for convenience:
     void flipColours();
     static bool isRed(RBNode *node);
@@ -64,17 +77,62 @@ private: // even the constructors are private since this class should only be us
 
     // main operations:
     // these functions use recursion in order to traverse the entire tree
-    static RBNode* insert(RBNode *h, Record *data);
+    static RBNode* insert(RBNode *h, Record *data, bool &added); // added is set to true if a new node was created
     static RBNode* erase(RBNode *h, Record *data);
     static RBNode* eraseMin(RBNode *h);
     static RBNode* findMin(RBNode *h);
     static RBNode* find(RBNode *h, Record *data);
-    void save(std::ofstream &fout) const;
-    void load(std::ifstream &fin, Record *type); // type is used to create correct subclass of Record
 
-    // the forEach function takes another function called func, and runs func for each Record stored in the tree
-    // func must return void and take a Record* as an argument
-    void forEach(const std::function<void(Record*)> &func);
+    // links n existing nodes, which are already in sorted order, into a valid red-black tree in O(n) time
+    // blackHeight is the number of black nodes on every path from the new root down to a null child
+    static RBNode* buildSorted(RBNode **sorted, int n, int blackHeight);
+    static int blackHeightFor(int n);
+
+    /*
+        Bulk removal by joining
+
+        join glues two trees back together with a node in between, in O(difference in their heights).
+        Erasing k sorted keys from a tree then goes: take the root apart from its two children, erase the keys smaller
+        than the root from the left child and the larger ones from the right child, and join the two back together
+        with the root in between (or, if the root was one of the keys, with the smallest node of the right side).
+        A subtree without any keys in it is left alone, so only the paths down to the keys are ever visited:
+        that costs O(k log(n / k)) instead of the O(k log n) of erasing them one at a time,
+        and never more than the O(n) of rebuilding the whole tree, however many keys there are.
+
+        The trees passed around always have a black root, and 'height' is their black height: the number of black nodes
+        on every path from the root down to a null child (0 for an empty tree).
+    */
+    // links left, mid and right into one tree, everything in left must be smaller than mid and everything in right larger
+    static RBNode* join(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight, int &height);
+    static RBNode* joinRight(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight); // left is taller
+    static RBNode* joinLeft(RBNode *left, int leftHeight, RBNode *mid, RBNode *right, int rightHeight); // right is taller
+    // deletes every node equal to one of the n keys, which must be sorted
+    static RBNode* eraseAll(RBNode *h, int height, Record **keys, int n, int &newHeight, int &erased);
+    // like eraseMin, but hands the smallest node over in min instead of deleting it
+    static RBNode* detachMin(RBNode *h, RBNode *&min);
+    static int blackHeight(RBNode *h);
+
+    // detaches every node of the subtree rooted at h and appends them to out in sorted order
+    static void collect(RBNode *h, std::vector<RBNode*> &out);
+
+    // number of nodes on the longest path from h down to a leaf
+    static int height(RBNode *h);
+
+    // black height of the subtree rooted at h, or -1 if it breaks the invariant (see above)
+    // or isn't in order (every Record must be strictly between low and high, when they aren't null)
+    static int checkInvariant(RBNode *h, const Record *low, const Record *high, bool parentRed);
+
+    // runs func(Record*) for each Record in the subtree rooted at h, in sorted order
+    // this is a template, so func gets inlined here instead of being called through a std::function for every Record,
+    // and the right child is visited by the loop instead of by another call
+    template<class Func>
+    static void forEach(RBNode *h, Func &func) {
+        while (h != nullptr) {
+            forEach(h->left(), func);
+            func(h->data);
+            h = h->right;
+        }
+    }
 };
 
 #endif // RBNODE_H
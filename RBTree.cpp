@@ -1,44 +1,106 @@
 #include "RBTree.h"
 
+#include <algorithm>
+
 void RBTree::insert(Record *data) {
-    root = RBNode::insert(root, data);
-    root->colour = RBNode::BLACK;
+    STATS_COUNT(lookups);
+    bool added = false;
+    root = RBNode::insert(root, data, added);
+    root->setColour(RBNode::BLACK);
+    if (added) count++;
 }
 
 void RBTree::erase(Record *data) {
     if (!contains(data)) return;
-    if (!RBNode::isRed(root->left) && !RBNode::isRed(root->right))
-        root->colour = RBNode::RED; // red-black tree special case
+    STATS_COUNT(lookups);
+    count--;
+    if (!RBNode::isRed(root->left()) && !RBNode::isRed(root->right))
+        root->setColour(RBNode::RED); // red-black tree special case
     root = RBNode::erase(root, data);
-    if (root) root->colour = RBNode::BLACK;
+    if (root) root->setColour(RBNode::BLACK);
 }
 
 bool RBTree::contains(Record *data) {
+    STATS_COUNT(lookups);
     return RBNode::find(root, data) != nullptr;
 }
 
+bool RBTree::isValid() const {
+    if (RBNode::isRed(root) || RBNode::checkInvariant(root, nullptr, nullptr, false) == -1) return false;
+    int n = 0;
+    for (iterator it = begin(); it != end(); ++it) n++;
+    return n == count;
+}
+
 Record* RBTree::get(Record *data) {
+    STATS_COUNT(lookups);
     RBNode *h = RBNode::find(root, data);
     if (h == nullptr) return nullptr;
     return h->data;
 }
 
+void RBTree::eraseAll(std::vector<Record*> keys) {
+    if (keys.empty() || root == nullptr) return;
 
-void RBTree::save(std::ofstream &fout) const {
-    writeByte(fout, root != nullptr); // do we even have a tree?
-    if (root != nullptr)
-        root->save(fout);
+    // the keys are shared out between the subtrees by binary search, so they have to be in order (see RBNode.h)
+    std::sort(keys.begin(), keys.end(), [](Record *a, Record *b) { return a->compare(b) < 0; });
+
+    STATS_COUNT(lookups);
+    int erased = 0, height;
+    root = RBNode::eraseAll(root, RBNode::blackHeight(root), keys.data(), keys.size(), height, erased);
+    count -= erased;
 }
-void RBTree::load(std::ifstream &fin, Record *type) {
-    bool hasTree = readByte(fin); // do we even have a tree?
-    if (hasTree) {
-        root = new RBNode(type->duplicateType(), 0);
-        root->load(fin, type);
+
+void RBTree::buildSorted(std::vector<Record*> &sorted) {
+    delete root;
+    std::vector<RBNode*> nodes;
+    nodes.reserve(sorted.size());
+    for (Record *r : sorted) nodes.push_back(new RBNode(r, RBNode::BLACK));
+    rebuild(nodes);
+}
+
+void RBTree::rebuild(std::vector<RBNode*> &sorted) {
+    count = sorted.size();
+    root = RBNode::buildSorted(sorted.data(), count, RBNode::blackHeightFor(count));
+}
+
+void RBTree::iterator::pushLeftmost(RBNode *h) {
+    for (; h != nullptr; h = h->left()) path[depth++] = h;
+}
+
+void RBTree::iterator::pushRightmost(RBNode *h) {
+    for (; h != nullptr; h = h->right) path[depth++] = h;
+}
+
+// the next Record is the smallest one in our right subtree, or if we don't have one,
+// the closest ancestor whose left subtree we are in
+RBTree::iterator& RBTree::iterator::operator++() {
+    RBNode *h = path[depth - 1];
+    if (h->right != nullptr) {
+        pushLeftmost(h->right);
+        return *this;
+    }
+    while (--depth > 0 && path[depth - 1]->right == h) h = path[depth - 1];
+    return *this;
+}
+
+// the mirror image of ++, and going back from end() gives the largest Record
+RBTree::iterator& RBTree::iterator::operator--() {
+    if (depth == 0) {
+        pushRightmost(root);
+        return *this;
+    }
+    RBNode *h = path[depth - 1];
+    if (h->left() != nullptr) {
+        pushRightmost(h->left());
+        return *this;
     }
+    while (--depth > 0 && path[depth - 1]->left() == h) h = path[depth - 1];
+    return *this;
 }
 
-// simply call RBNode's forEach, provided the root exists
-void RBTree::forEach(const std::function<void(Record*)> &func) {
-    if (root != nullptr)
-        root->forEach(func);
+RBTree::iterator RBTree::begin() const {
+    iterator it(root);
+    it.pushLeftmost(root);
+    return it;
 }
@@ -2,8 +2,9 @@
 #define RBTREE_H
 
 #include "RBNode.h"
-#include "EasySaveLoad.h"
-#include <fstream>
+#include <cstddef>
+#include <iterator>
+#include <vector>
 
 /*
     Red Black trees are a special type of binary search tree (bst for short)
@@ -32,9 +33,12 @@
     we must check if the invariant has been violated, and restore the invariant if needed
 */
 
-class RBTree : public EasySaveLoad {
+class RBTree {
 private:
     RBNode *root = nullptr; // the root node of the tree
+    int count = 0; // number of Records in the tree
+
+    void rebuild(std::vector<RBNode*> &sorted); // link already sorted nodes into a new tree
 public:
     RBTree() {};
     ~RBTree() { delete root; } // 1 of 3
@@ -47,15 +51,79 @@ public:
     void insert(Record *data); // add a Record to the red-black tree
     void erase(Record *data); // erase a Record from the red-black tree
     bool contains(Record *data); // check if a Record exists within the red-black tree
+    inline int size() const { return count; }
+    inline int height() const { return RBNode::height(root); } // longest path from the root, in nodes
+    // checks the red-black invariant, the order of the Records and the count, for the self test (see cli/SelfTest.h)
+    bool isValid() const;
+
+    // bulk removal, cheaper than calling erase for each Record, however many of them there are (see RBNode.h):
+    // erase every Record which compares equal to one of the keys (keys which aren't in the tree are ignored)
+    void eraseAll(std::vector<Record*> keys);
+    // erase every Record for which pred(Record*) returns true, always visiting the whole tree
+    template<class Pred>
+    void eraseIf(Pred pred) {
+        std::vector<RBNode*> nodes, survivors, erased;
+        nodes.reserve(count);
+        RBNode::collect(root, nodes);
+        root = nullptr;
+
+        for (RBNode *node : nodes) {
+            if (pred(node->data)) erased.push_back(node);
+            else survivors.push_back(node);
+        }
+        // delete only after every Record was checked, since pred might still need an erased Record
+        for (RBNode *node : erased) delete node;
+
+        rebuild(survivors);
+    }
 
     // the data argument is an 'incomplete' record, which only has enough information to compare with other Records
     // function will return a 'complete' record, where returned_record->compare(data) == 0
     Record* get(Record *data);
 
-    void save(std::ofstream &fout) const;
-    void load(std::ifstream &fin, Record *type); // type is used to create correct subclass of Record
+    // replace the contents of the tree with the given Records, which must already be sorted and contain no duplicates
+    // much faster than inserting them one by one since no comparisons or rebalancing are needed
+    void buildSorted(std::vector<Record*> &sorted);
+
+    // runs func(Record*) for every Record in sorted order, see RBNode::forEach
+    // the fastest way to visit everything, but it can't stop part way, use the iterators below for that
+    template<class Func>
+    void forEach(Func &&func) { RBNode::forEach(root, func); }
+
+    // in-order iterator, so the tree can be used in range-for loops (for (Record *r : tree)) and standard algorithms
+    // nodes don't know their parent, so the iterator keeps the path from the root down to its node instead
+    // changing the tree makes every iterator invalid
+    class iterator {
+        friend class RBTree;
+    private:
+        // a red-black tree is at most 2 * log2(n + 1) nodes tall, which for an int number of Records is under 64
+        static const int MAX_HEIGHT = 64;
+        RBNode *root;
+        RBNode *path[MAX_HEIGHT]; // path[depth - 1] is the current node, and end() has an empty path
+        int depth = 0;
+
+        explicit iterator(RBNode *root) : root(root) {}
+        void pushLeftmost(RBNode *h); // go down from h to the smallest Record under it
+        void pushRightmost(RBNode *h); // or the largest
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Record* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Record* const* pointer;
+        typedef Record* const& reference;
 
-    void forEach(const std::function<void(Record*)> &func);
+        inline reference operator*() const { return path[depth - 1]->data; }
+        iterator& operator++();
+        iterator& operator--();
+        inline iterator operator++(int) { iterator old = *this; ++*this; return old; }
+        inline iterator operator--(int) { iterator old = *this; --*this; return old; }
+        inline bool operator==(const iterator &that) const {
+            return depth == that.depth && (depth == 0 || path[depth - 1] == that.path[depth - 1]);
+        }
+        inline bool operator!=(const iterator &that) const { return !(*this == that); }
+    };
+    iterator begin() const;
+    inline iterator end() const { return iterator(root); }
 };
 
 #endif // RBTREE_H
@@ -0,0 +1,144 @@
+#include "SeatAllocator.h"
+
+#include <algorithm>
+
+SeatAllocator::SeatAllocator(int capacity) : capacity(capacity) {
+    if (capacity > 0) addRun(0, capacity);
+}
+
+int SeatAllocator::allocate(int length) {
+    Node node;
+    node.prefix = node.suffix = node.best = length;
+    if (!unused.empty()) {
+        int index = unused.back();
+        unused.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+void SeatAllocator::release(int node) {
+    if (node == -1) return;
+    release(nodes[node].left);
+    release(nodes[node].right);
+    unused.push_back(node);
+}
+
+SeatAllocator::Node SeatAllocator::stats(int node, int length) const {
+    if (node != -1) return nodes[node];
+    Node free;
+    free.prefix = free.suffix = free.best = length;
+    return free;
+}
+
+int SeatAllocator::update(int node, int lo, int hi, int seat, bool occupied) {
+    if (node == -1) {
+        if (!occupied) return -1; // already all free
+        node = allocate(hi - lo);
+    }
+    if (hi - lo == 1) { // a single seat
+        if (!occupied) {
+            release(node);
+            return -1;
+        }
+        nodes[node].prefix = nodes[node].suffix = nodes[node].best = 0;
+        return node;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    // the child's index is stored only after the call, since allocating may move nodes around in memory
+    if (seat < mid) {
+        int child = update(nodes[node].left, lo, mid, seat, occupied);
+        nodes[node].left = child;
+    }
+    else {
+        int child = update(nodes[node].right, mid, hi, seat, occupied);
+        nodes[node].right = child;
+    }
+
+    // combine the two halves:
+    Node l = stats(nodes[node].left, mid - lo), r = stats(nodes[node].right, hi - mid);
+    Node &n = nodes[node];
+    n.prefix = l.prefix == mid - lo ? mid - lo + r.prefix : l.prefix;
+    n.suffix = r.suffix == hi - mid ? hi - mid + l.suffix : r.suffix;
+    n.best = std::max(std::max(l.best, r.best), l.suffix + r.prefix);
+
+    if (n.best == hi - lo) { // completely free again, so the node isn't needed anymore
+        release(node);
+        return -1;
+    }
+    return node;
+}
+
+// assuming the range has a free run of at least k, find where the first one starts
+int SeatAllocator::descend(int node, int lo, int hi, int k) const {
+    if (node == -1 || hi - lo == 1) return lo; // completely free, or a single free seat
+    int mid = lo + (hi - lo) / 2;
+    Node l = stats(nodes[node].left, mid - lo), r = stats(nodes[node].right, hi - mid);
+    if (l.best >= k) return descend(nodes[node].left, lo, mid, k); // fits entirely in the left half
+    if (l.suffix + r.prefix >= k) return mid - l.suffix; // fits across the middle
+    return descend(nodes[node].right, mid, hi, k);
+}
+
+void SeatAllocator::addRun(int start, int length) {
+    if (length <= 0) return;
+    runsByStart[start] = length;
+    runsBySize.insert(std::make_pair(length, start));
+}
+
+void SeatAllocator::removeRun(int start) {
+    auto it = runsByStart.find(start);
+    runsBySize.erase(std::make_pair(it->second, start));
+    runsByStart.erase(it);
+}
+
+void SeatAllocator::occupy(int seat) {
+    root = update(root, 0, capacity, seat, true);
+
+    // split the run the seat was in
+    auto it = --runsByStart.upper_bound(seat); // the last run starting at or before seat
+    int start = it->first, length = it->second;
+    removeRun(start);
+    addRun(start, seat - start);
+    addRun(seat + 1, start + length - seat - 1);
+}
+
+void SeatAllocator::free(int seat) {
+    root = update(root, 0, capacity, seat, false);
+
+    // the seat joins up with the runs right before and right after it, if there are any
+    int start = seat, end = seat + 1;
+    auto after = runsByStart.find(seat + 1);
+    if (after != runsByStart.end()) {
+        end += after->second;
+        removeRun(seat + 1);
+    }
+    auto before = runsByStart.lower_bound(seat);
+    if (before != runsByStart.begin()) {
+        --before;
+        if (before->first + before->second == seat) {
+            start = before->first;
+            removeRun(start);
+        }
+    }
+    addRun(start, end - start);
+}
+
+int SeatAllocator::longestFreeRun() const {
+    if (runsBySize.empty()) return 0;
+    return runsBySize.rbegin()->first;
+}
+
+int SeatAllocator::firstFit(int k) const {
+    if (k < 1 || k > longestFreeRun()) return -1;
+    return descend(root, 0, capacity, k);
+}
+
+int SeatAllocator::bestFit(int k) const {
+    if (k < 1) return -1;
+    auto it = runsBySize.lower_bound(std::make_pair(k, -1));
+    if (it == runsBySize.end()) return -1;
+    return it->second;
+}
@@ -0,0 +1,64 @@
+#ifndef SEATALLOCATOR_H
+#define SEATALLOCATOR_H
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*
+    Free seat allocator
+
+    Picking seats for a group that wants to sit together means finding a run of k free seats in a row,
+    which a scan over the seats would do in O(number of seats) per booking.
+    Instead every Flight keeps a SeatAllocator up to date as seats are taken and freed (see Flight::setSeat),
+    which answers these in O(log n):
+    - longestFreeRun: the most free seats in a row anywhere on the flight
+    - firstFit(k): the lowest numbered seat starting a run of at least k free seats
+    - bestFit(k): the start of the shortest run of at least k free seats (lowest numbered if there is a tie),
+      which leaves the longer runs for bigger groups
+
+    firstFit uses a segment tree: every node covers a range of seats and remembers the longest free run
+    in that range, along with the free runs touching its left and right ends, so we can tell which half
+    a run of k seats starts in without looking inside the halves.
+    Ranges that are completely free don't get nodes at all (a missing child means 'all free'),
+    so a big, mostly empty flight only has nodes along the paths down to its occupied seats.
+
+    bestFit and longestFreeRun use the list of maximal free runs, sorted by length.
+    Both structures have a size which depends on the number of occupied seats, like SeatMap.
+*/
+class SeatAllocator {
+private:
+    struct Node {
+        int prefix, suffix, best; // free run at the start, free run at the end, longest free run
+        int left = -1, right = -1; // children's indices in nodes, -1 if that half is completely free
+    };
+    std::vector<Node> nodes;
+    std::vector<int> unused; // indices of nodes which were released and can be handed out again
+    int root = -1;
+    int capacity;
+
+    std::map<int, int> runsByStart; // every maximal free run: start -> length
+    std::set<std::pair<int, int>> runsBySize; // the same runs as (length, start)
+
+    int allocate(int length); // a node for a completely free range
+    void release(int node); // also releases its children
+    Node stats(int node, int length) const; // what node knows, also for missing (completely free) nodes
+    int update(int node, int lo, int hi, int seat, bool occupied); // returns the node's new index (or -1)
+    int descend(int node, int lo, int hi, int k) const;
+
+    void addRun(int start, int length);
+    void removeRun(int start);
+public:
+    explicit SeatAllocator(int capacity); // every seat starts out free
+    // rule of three: the containers take care of themselves, and copying them copies everything
+
+    void occupy(int seat);
+    void free(int seat);
+
+    int longestFreeRun() const;
+    int firstFit(int k) const; // -1 if there is no such run
+    int bestFit(int k) const; // -1 if there is no such run
+};
+
+#endif // SEATALLOCATOR_H
@@ -0,0 +1,75 @@
+#include "SeatMap.h"
+
+#include <algorithm>
+#include <cstring>
+
+// binary search helper: orders a Seat before a seat number
+static bool seatBefore(const std::pair<int, Customer*> &seat, int i) { return seat.first < i; }
+
+SeatMap::SeatMap(int capacity) : capacity(capacity) {} // starts out sparse, since nobody is seated yet
+
+SeatMap::~SeatMap() {
+    delete[] dense; // works even if dense is null
+}
+
+SeatMap& SeatMap::operator=(const SeatMap &rhs) {
+    if (this == &rhs) return *this;
+    capacity = rhs.capacity;
+    count = rhs.count;
+    sparse = rhs.sparse;
+
+    delete[] dense;
+    dense = nullptr;
+    if (rhs.dense) {
+        dense = new Customer*[capacity];
+        memcpy(dense, rhs.dense, sizeof(Customer*) * capacity);
+    }
+    return *this;
+}
+SeatMap::SeatMap(const SeatMap &sm) {
+    *this = sm; // overloaded assignment is able to properly initialize dense
+}
+
+Customer* SeatMap::get(int i) const {
+    if (dense) return dense[i];
+    auto it = std::lower_bound(sparse.begin(), sparse.end(), i, seatBefore);
+    if (it == sparse.end() || it->first != i) return nullptr;
+    return it->second;
+}
+
+void SeatMap::set(int i, Customer *c) {
+    if (dense) {
+        count += (c != nullptr) - (dense[i] != nullptr);
+        dense[i] = c;
+        if (count < capacity / 8) makeSparse();
+        return;
+    }
+
+    auto it = std::lower_bound(sparse.begin(), sparse.end(), i, seatBefore);
+    bool found = it != sparse.end() && it->first == i;
+    if (found && c) it->second = c; // someone else takes the seat
+    else if (found) { // seat emptied
+        sparse.erase(it);
+        count--;
+    }
+    else if (c) { // seat taken
+        sparse.insert(it, Seat(i, c));
+        count++;
+        if (count >= capacity / 4) makeDense();
+    }
+}
+
+void SeatMap::makeDense() {
+    dense = new Customer*[capacity];
+    memset(dense, 0, sizeof(Customer*) * capacity);
+    for (const Seat &seat : sparse) dense[seat.first] = seat.second;
+    std::vector<Seat>().swap(sparse); // swapping with an empty vector actually frees the memory
+}
+
+void SeatMap::makeSparse() {
+    sparse.reserve(count);
+    for (int i = 0; i < capacity; i++)
+        if (dense[i]) sparse.push_back(Seat(i, dense[i]));
+    delete[] dense;
+    dense = nullptr;
+}
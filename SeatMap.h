@@ -0,0 +1,63 @@
+#ifndef SEATMAP_H
+#define SEATMAP_H
+
+#include <utility>
+#include <vector>
+
+class Customer;
+
+/*
+    Seat map
+
+    A flight used to keep an array with a pointer for every seat, which is wasteful for big flights
+    that are mostly empty: memory (and anything going through the seats) grew with the number of seats,
+    not with the number of passengers.
+
+    So a SeatMap is kept in one of two ways, and switches between them by itself depending on how full it is:
+    - sparse: only the occupied seats, as (seat number, Customer) pairs sorted by seat number
+      each takes 16 bytes, and finding a seat is a binary search
+    - dense: the old array, one pointer (8 bytes) per seat, and finding a seat is a single lookup
+
+    It becomes dense once a quarter of the seats are taken, and goes back to sparse when less than an eighth are
+    (the gap between the two stops a flight from switching back and forth while one passenger books and cancels)
+    Either way, forEachOccupied only visits occupied seats.
+*/
+class SeatMap {
+private:
+    typedef std::pair<int, Customer*> Seat;
+
+    int capacity; // number of seats
+    int count = 0; // number of occupied seats
+    Customer **dense = nullptr; // when this isn't null, dense[i] is seat i's occupant (or nullptr)
+    std::vector<Seat> sparse; // otherwise, the occupied seats sorted by seat number
+
+    void makeDense();
+    void makeSparse();
+public:
+    explicit SeatMap(int capacity);
+    ~SeatMap(); // 1 of 3
+    SeatMap& operator=(const SeatMap &rhs); // 2 of 3
+    SeatMap(const SeatMap &sm); // 3 of 3
+
+    inline int size() const { return capacity; }
+    inline int occupied() const { return count; }
+    inline bool isDense() const { return dense != nullptr; }
+
+    // i must be a valid seat number (Flight does the bounds checking)
+    Customer* get(int i) const;
+    void set(int i, Customer *c);
+
+    // runs func(seat number, occupant) for every occupied seat, in increasing seat order
+    template<class Func>
+    void forEachOccupied(Func func) const {
+        if (dense) {
+            for (int i = 0; i < capacity; i++)
+                if (dense[i]) func(i, dense[i]);
+        }
+        else {
+            for (const Seat &seat : sparse) func(seat.first, seat.second);
+        }
+    }
+};
+
+#endif // SEATMAP_H
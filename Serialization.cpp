@@ -0,0 +1,216 @@
+#include "Serialization.h"
+
+#include <QByteArray>
+#include <algorithm>
+#include <cstring>
+
+// fixed size 8 byte numbers, used for the block index since it is read from a known position at the end of the file
+static void putFixed64(std::string &s, long long v) {
+    for (int j = 0; j < 8; j++) s.push_back((v >> (8 * j)) & 0xff);
+}
+static long long readFixed64(std::istream &in) {
+    unsigned char c[8] = {};
+    in.read(reinterpret_cast<char*>(c), 8);
+    long long v = 0;
+    for (int j = 7; j >= 0; j--) v = (v << 8) | c[j];
+    return v;
+}
+
+void ByteWriter::writeRaw(const char *data, size_t len) {
+    out.write(data, len);
+    fileBytes += len;
+}
+
+// each block is written as its compressed size (4 bytes) followed by the compressed bytes
+// level 1 is zlib's fastest setting, since the file is saved after every change
+void ByteWriter::writeBlock(const char *data, size_t len) {
+    blockOffsets.push_back(fileBytes);
+    QByteArray compressed = qCompress(reinterpret_cast<const uchar*>(data), len, 1);
+    std::string header;
+    for (int j = 0; j < 4; j++) header.push_back((compressed.size() >> (8 * j)) & 0xff);
+    writeRaw(header.data(), 4);
+    writeRaw(compressed.constData(), compressed.size());
+    flushed += len;
+}
+
+void ByteWriter::flush() {
+    if (!blocks) {
+        writeRaw(buffer.data(), buffer.size());
+        flushed += buffer.size();
+        buffer.clear();
+        return;
+    }
+    // only whole blocks, so that every block (except the last) has exactly BLOCK_SIZE bytes
+    size_t done = 0;
+    while (buffer.size() - done >= BLOCK_SIZE) {
+        writeBlock(buffer.data() + done, BLOCK_SIZE);
+        done += BLOCK_SIZE;
+    }
+    buffer.erase(0, done);
+}
+
+void ByteWriter::startBlocks() {
+    flush();
+    blocks = true;
+}
+
+// the block index goes at the very end: number of blocks, where each block starts,
+// and finally where the index itself starts, so a reader can find it by looking at the last 8 bytes
+void ByteWriter::finish() {
+    flush();
+    if (!blocks) return;
+    if (!buffer.empty()) writeBlock(buffer.data(), buffer.size());
+    buffer.clear();
+
+    std::string index;
+    putFixed64(index, blockOffsets.size());
+    for (long long offset : blockOffsets) putFixed64(index, offset);
+    putFixed64(index, fileBytes);
+    writeRaw(index.data(), index.size());
+    blocks = false; // so that finishing twice (e.g. in the destructor) does nothing
+}
+
+void ByteWriter::putBytes(const char *data, size_t len) {
+    buffer.append(data, len);
+    if (buffer.size() >= (1 << 16)) flush();
+}
+
+void ByteWriter::putVarint(unsigned long long v) {
+    while (v >= 0x80) { // more than 7 bits left, so write the lowest 7 and set the 'more follows' bit
+        putByte((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    putByte(v);
+}
+
+ByteReader::ByteReader(std::istream &in, size_t bufferSize) : in(in), buffer(bufferSize) {
+    bufferStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    end = in.tellg();
+    in.seekg(bufferStart);
+    if (bufferStart < 0 || end < 0) failed = true; // the stream was already bad
+}
+
+bool ByteReader::refill() {
+    if (blocks) return loadBlock(currentBlock + 1);
+
+    bufferStart += len;
+    pos = len = 0;
+    if (!failed) {
+        in.read(buffer.data(), buffer.size());
+        len = in.gcount();
+    }
+    if (len == 0) failed = true;
+    return len > 0;
+}
+
+bool ByteReader::loadBlock(long long index) {
+    pos = len = 0;
+    if (index < 0 || index >= static_cast<long long>(blockOffsets.size())) {
+        failed = true;
+        return false;
+    }
+
+    in.clear();
+    in.seekg(blockOffsets[index]);
+    unsigned char header[4] = {};
+    in.read(reinterpret_cast<char*>(header), 4);
+    int size = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
+    if (size < 0 || blockOffsets[index] + 4 + size > indexStart) { // runs into the index, or past the end of the file
+        failed = true;
+        return false;
+    }
+    QByteArray compressed(size, '\0');
+    in.read(compressed.data(), size);
+    QByteArray data = qUncompress(compressed); // gives an empty array if the block is damaged
+    if (data.isEmpty()) {
+        failed = true;
+        return false;
+    }
+
+    buffer.assign(data.constData(), data.constData() + data.size());
+    len = data.size();
+    bufferStart = blocksStart + index * static_cast<long long>(BLOCK_SIZE);
+    currentBlock = index;
+    return true;
+}
+
+void ByteReader::startBlocks() {
+    blocksStart = position();
+
+    in.clear();
+    in.seekg(-8, std::ios::end);
+    indexStart = readFixed64(in);
+    in.seekg(indexStart);
+    long long count = readFixed64(in);
+    // the index is 8 bytes per block, between its own count and the 8 bytes pointing at it
+    if (!in.good() || indexStart < blocksStart || count < 0 || count > (end - 16 - indexStart) / 8) {
+        failed = true;
+        return;
+    }
+    blockOffsets.resize(count);
+    for (long long &offset : blockOffsets) offset = readFixed64(in);
+
+    blocks = true;
+    end = blocksStart + count * static_cast<long long>(BLOCK_SIZE); // every block but the last is exactly this big
+    currentBlock = -1;
+    pos = len = 0;
+    bufferStart = blocksStart;
+}
+
+void ByteReader::getBytes(char *data, size_t n) {
+    while (n > 0) {
+        if (pos == len && !refill()) {
+            memset(data, 0, n);
+            return;
+        }
+        size_t chunk = std::min(n, len - pos);
+        memcpy(data, buffer.data() + pos, chunk);
+        pos += chunk;
+        data += chunk;
+        n -= chunk;
+    }
+}
+
+bool ByteReader::fits(unsigned long long n) {
+    if (!failed && position() <= end && n <= static_cast<unsigned long long>(end - position())) return true;
+    failed = true;
+    return false;
+}
+
+void ByteReader::getString(std::string &s, unsigned long long n) {
+    if (!fits(n)) return;
+    while (n > 0 && !failed) {
+        size_t start = s.size(), chunk = std::min(n, static_cast<unsigned long long>(4096));
+        s.resize(start + chunk);
+        getBytes(&s[start], chunk);
+        n -= chunk;
+    }
+}
+
+unsigned long long ByteReader::getVarint() {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char c = getByte();
+        v |= static_cast<unsigned long long>(c & 0x7f) << shift;
+        if (!(c & 0x80)) break; // no more bytes follow
+    }
+    return v;
+}
+
+void ByteReader::seek(long long target) {
+    if (target >= bufferStart && target <= bufferStart + static_cast<long long>(len)) { // still inside the buffer
+        pos = target - bufferStart;
+        return;
+    }
+    if (blocks) { // only the block that target falls in has to be decompressed
+        long long index = (target - blocksStart) / static_cast<long long>(BLOCK_SIZE);
+        if (loadBlock(index)) pos = target - bufferStart;
+        return;
+    }
+    // jump straight to the target, the next read refills the buffer from there
+    in.clear();
+    in.seekg(target);
+    bufferStart = target;
+    pos = len = 0;
+}
@@ -0,0 +1,214 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/*
+    Type-directed serialization
+
+    Instead of every Record writing itself field by field through a virtual save/load,
+    each type that goes on disk declares its fields once, in a specialization of RecordLayout:
+
+        template<> struct RecordLayout<Thing> {
+            static constexpr auto keyFields() { return std::make_tuple(&Thing::a, &Thing::b); }
+            static constexpr auto payloadFields() { return std::make_tuple(&Thing::c); }
+            static Thing* make() { return new Thing(); }
+            static void loaded(Thing &t) {} // called once a record has been fully decoded
+        };
+
+    key fields are whatever compare() looks at, payload fields are everything else
+    the templates below use these lists to generate the encoders and decoders at compile time,
+    so there is no virtual call (and no allocation) per field
+
+    integers are written as varints: 7 bits per byte, the high bit says whether another byte follows
+    so small numbers (string lengths, seat numbers) take a single byte instead of four
+*/
+template<class T> struct RecordLayout;
+
+/*
+    Block compression
+
+    Either stream can be switched into block mode part way through (startBlocks), after which the bytes are
+    cut into blocks of BLOCK_SIZE bytes which are each compressed separately, followed by an index of where
+    every block starts in the file.
+    Positions always count the bytes before compression, so the rest of the code doesn't need to know about it,
+    and a reader can still jump to any position by only decompressing the block it falls in.
+*/
+static const size_t BLOCK_SIZE = 1 << 14;
+
+// buffered output which keeps track of how many bytes were written so far
+class ByteWriter {
+private:
+    std::ostream &out;
+    std::string buffer;
+    long long flushed = 0; // bytes already handed to out (counted before compression)
+
+    bool blocks = false; // are we in block mode?
+    long long fileBytes = 0; // bytes actually written to out (counted after compression)
+    std::vector<long long> blockOffsets; // where in the file each block starts
+
+    void writeRaw(const char *data, size_t len);
+    void writeBlock(const char *data, size_t len);
+    void flush(); // hand over as much of buffer as we can
+public:
+    explicit ByteWriter(std::ostream &out) : out(out) {}
+    ~ByteWriter() { finish(); } // 1 of 3
+    ByteWriter& operator=(const ByteWriter &rhs) = delete; // 2 of 3
+    ByteWriter(const ByteWriter &bw) = delete; // 3 of 3
+
+    void startBlocks(); // compress everything written from now on
+    void finish(); // write out whatever is left (and the block index, in block mode), nothing can be written after this
+    inline long long position() const { return flushed + buffer.size(); }
+
+    inline void putByte(unsigned char c) {
+        buffer.push_back(c);
+        if (buffer.size() >= (1 << 16)) flush();
+    }
+    void putBytes(const char *data, size_t len);
+    void putVarint(unsigned long long v);
+};
+
+// buffered input, reading past the end just gives zeros and makes good() return false
+class ByteReader {
+private:
+    std::istream &in;
+    std::vector<char> buffer;
+    size_t pos = 0, len = 0; // next byte to read and number of valid bytes in buffer
+    long long bufferStart; // position in the stream of buffer[0]
+    long long end; // position where the data runs out: the end of the stream, or in block mode, of the last block
+    bool failed = false;
+
+    bool blocks = false; // are we in block mode?
+    long long blocksStart = 0; // position at which block mode started
+    long long indexStart = 0; // where in the file the block index starts, every block has to end before it
+    std::vector<long long> blockOffsets; // where in the file each block starts
+    long long currentBlock = -1; // which block is in buffer
+
+    bool refill();
+    bool loadBlock(long long index);
+public:
+    // bufferSize is how much is read from the stream at once, use a small one when only a few bytes are needed
+    ByteReader(std::istream &in, size_t bufferSize = 1 << 16);
+
+    inline bool good() const { return !failed; }
+    inline long long position() const { return bufferStart + pos; }
+
+    void startBlocks(); // must be called at the same position as the writer's startBlocks
+
+    inline unsigned char getByte() {
+        if (pos == len && !refill()) return 0;
+        return buffer[pos++];
+    }
+    void getBytes(char *data, size_t n);
+    unsigned long long getVarint();
+
+    // counts and lengths come from the file, so a broken one can ask for far more than the file could possibly hold
+    // every one of them has to be checked with fits before anything is allocated for it:
+    // it returns false (and the reader fails) if fewer than n bytes are left, and everything on disk takes at least a byte
+    bool fits(unsigned long long n);
+    // appends n bytes to s, a chunk at a time (in block mode the end is only known to within a block or so)
+    void getString(std::string &s, unsigned long long n);
+    void seek(long long position);
+    inline void skip(long long n) { seek(position() + n); }
+};
+
+// how a single field is written, read and measured, there's one overload per field type:
+// ints are zigzag encoded first (0, -1, 1, -2, ... becomes 0, 1, 2, 3, ...) so that -1 still takes a single byte
+inline unsigned long long zigzag(int i) { return (static_cast<unsigned long long>(i) << 1) ^ static_cast<unsigned long long>(static_cast<long long>(i) >> 63); }
+inline int unzigzag(unsigned long long u) { return static_cast<int>((u >> 1) ^ (~(u & 1) + 1)); }
+
+inline size_t varintSize(unsigned long long v) {
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+inline void encodeField(ByteWriter &w, int i) { w.putVarint(zigzag(i)); }
+inline void encodeField(ByteWriter &w, const std::string &s) {
+    w.putVarint(s.size());
+    w.putBytes(s.data(), s.size());
+}
+inline void decodeField(ByteReader &r, int &i) { i = unzigzag(r.getVarint()); }
+inline void decodeField(ByteReader &r, std::string &s) {
+    s.clear();
+    r.getString(s, r.getVarint());
+}
+inline size_t fieldSize(int i) { return varintSize(zigzag(i)); }
+inline size_t fieldSize(const std::string &s) { return varintSize(s.size()) + s.size(); }
+
+// key columns are sorted (at least by their first field), so neighbouring strings usually start the same way
+// front coding only writes how many characters are shared with the previous value, followed by the rest
+inline void encodeKeyField(ByteWriter &w, int i, int) { encodeField(w, i); }
+inline void encodeKeyField(ByteWriter &w, const std::string &s, const std::string &previous) {
+    size_t shared = 0;
+    while (shared < s.size() && shared < previous.size() && s[shared] == previous[shared]) shared++;
+    w.putVarint(shared);
+    w.putVarint(s.size() - shared);
+    w.putBytes(s.data() + shared, s.size() - shared);
+}
+inline void decodeKeyField(ByteReader &r, int &i, const int &) { decodeField(r, i); }
+inline void decodeKeyField(ByteReader &r, std::string &s, const std::string &previous) {
+    size_t shared = r.getVarint();
+    if (shared > previous.size()) shared = previous.size(); // only happens with a broken file
+    unsigned long long rest = r.getVarint();
+    s.assign(previous, 0, shared);
+    r.getString(s, rest);
+}
+
+// calls func once for every member pointer in the tuple, this all gets inlined into straight-line code
+template<class Fields, class Func>
+inline void forEachField(const Fields &fields, Func &&func) {
+    std::apply([&func](auto... member) { (func(member), ...); }, fields);
+}
+
+// key fields are written as front coded columns: every record's first key field, then every record's second key field,
+// and so on, keeping similar data together like this also helps the compression (see Snapshot.h)
+template<class T>
+void writeKeyColumns(ByteWriter &w, const std::vector<T*> &records) {
+    forEachField(RecordLayout<T>::keyFields(), [&w, &records](auto member) {
+        typename std::decay<decltype(records[0]->*member)>::type empty{};
+        const auto *previous = &empty;
+        for (const T *r : records) {
+            encodeKeyField(w, r->*member, *previous);
+            previous = &(r->*member);
+        }
+    });
+}
+// frontCoded is only false for files from before front coding was added (see Snapshot.cpp)
+template<class T>
+void readKeyColumns(ByteReader &in, std::vector<T*> &records, bool frontCoded = true) {
+    forEachField(RecordLayout<T>::keyFields(), [&in, &records, frontCoded](auto member) {
+        typename std::decay<decltype(records[0]->*member)>::type empty{};
+        const auto *previous = &empty;
+        for (T *r : records) {
+            if (frontCoded) decodeKeyField(in, r->*member, *previous);
+            else decodeField(in, r->*member);
+            previous = &(r->*member);
+        }
+    });
+}
+
+// payload fields are written row by row, so that a single record can be decoded on its own (see CustomerCache.h)
+template<class T>
+size_t payloadSize(const T &r) {
+    size_t size = 0;
+    forEachField(RecordLayout<T>::payloadFields(), [&size, &r](auto member) { size += fieldSize(r.*member); });
+    return size;
+}
+template<class T>
+void writePayload(ByteWriter &w, const T &r) {
+    forEachField(RecordLayout<T>::payloadFields(), [&w, &r](auto member) { encodeField(w, r.*member); });
+}
+template<class T>
+void readPayload(ByteReader &in, T &r) {
+    forEachField(RecordLayout<T>::payloadFields(), [&in, &r](auto member) { decodeField(in, r.*member); });
+    RecordLayout<T>::loaded(r);
+}
+
+#endif // SERIALIZATION_H
@@ -0,0 +1,84 @@
+#include "ShardedCustomerStore.h"
+
+#include <algorithm>
+#include <string>
+
+ShardedCustomerStore::ShardedCustomerStore(int numShards) {
+    if (numShards < 1) numShards = 1;
+    for (int i = 0; i < numShards; i++) shards.emplace_back(new Shard());
+}
+
+// the shard only depends on the key (name and phone number), so a key object finds the same shard as the full Customer
+size_t ShardedCustomerStore::shardIndex(const Record *data) const {
+    if (shards.size() == 1) return 0; // the default (see DEFAULT_SHARDS), hashing two strings per operation would be wasted
+    const Customer *c = static_cast<const Customer*>(data);
+    std::hash<std::string> hash;
+    return (hash(c->getName()) * 31 + hash(c->getPhoneNumber())) % shards.size();
+}
+
+ShardedCustomerStore::Shard& ShardedCustomerStore::shardFor(const Record *data) {
+    return *shards[shardIndex(data)];
+}
+
+void ShardedCustomerStore::insert(Record *data) {
+    Shard &shard = shardFor(data);
+    std::lock_guard<std::mutex> guard(shard.lock); // unlocks automatically when we return
+    shard.tree.insert(data);
+}
+
+void ShardedCustomerStore::erase(Record *data) {
+    Shard &shard = shardFor(data);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.tree.erase(data);
+}
+
+bool ShardedCustomerStore::contains(Record *data) {
+    Shard &shard = shardFor(data);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.tree.contains(data);
+}
+
+Record* ShardedCustomerStore::get(Record *data) {
+    Shard &shard = shardFor(data);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.tree.get(data);
+}
+
+int ShardedCustomerStore::size() {
+    int total = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->tree.size();
+    }
+    return total;
+}
+
+int ShardedCustomerStore::height() {
+    int tallest = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        tallest = std::max(tallest, shard->tree.height());
+    }
+    return tallest;
+}
+
+// split the keys up by shard, then every shard does a single bulk erase
+void ShardedCustomerStore::eraseAll(const std::vector<Record*> &keys) {
+    std::vector<std::vector<Record*>> perShard(shards.size());
+    for (Record *key : keys) perShard[shardIndex(key)].push_back(key);
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (perShard[i].empty()) continue;
+        std::lock_guard<std::mutex> guard(shards[i]->lock);
+        shards[i]->tree.eraseAll(perShard[i]);
+    }
+}
+
+// splitting a sorted list up by shard keeps each part sorted, so every shard can be built directly
+void ShardedCustomerStore::buildSorted(std::vector<Record*> &sorted) {
+    std::vector<std::vector<Record*>> perShard(shards.size());
+    for (Record *r : sorted) perShard[shardIndex(r)].push_back(r);
+    for (size_t i = 0; i < shards.size(); i++) {
+        std::lock_guard<std::mutex> guard(shards[i]->lock);
+        shards[i]->tree.buildSorted(perShard[i]);
+    }
+}
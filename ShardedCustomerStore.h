@@ -0,0 +1,114 @@
+#ifndef SHARDEDCUSTOMERSTORE_H
+#define SHARDEDCUSTOMERSTORE_H
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "Customer.h"
+
+/*
+    Sharded customer store
+
+    With a single RBTree, every booking has to go through the same structure, so even with several threads
+    only one of them could be changing the customers at a time.
+    Instead, customers are split between several independent RBTrees (shards) depending on a hash of their
+    name and phone number, and each shard has its own lock, so bookings for different shards never wait on each other.
+
+    Operations on a single customer only lock the shard it hashes to.
+    Operations on every customer (forEach, buildSorted) lock all shards, always in the same order so they can't deadlock,
+    and forEach merges the shards back together so customers are still visited in sorted order.
+
+    This is still experimental: Database runs one operation at a time, so it keeps a single shard (see DEFAULT_SHARDS),
+    which skips the hashing and merging and is then just one RBTree behind a lock nobody else ever takes.
+    Only bench-shards (cli/Benchmarks.cpp) uses more shards, from several threads.
+
+    Note that get() hands out a pointer which the store keeps owning: the caller has to make sure nobody erases
+    that customer while it is still being used (the GUI only has one thread, so this is only a concern for benchmarks)
+*/
+class ShardedCustomerStore {
+private:
+    struct Shard {
+        RBTree tree;
+        std::mutex lock;
+    };
+    std::vector<std::unique_ptr<Shard>> shards; // RBTree and mutex can't be copied or moved, so they are kept on the heap
+
+    size_t shardIndex(const Record *data) const;
+    Shard& shardFor(const Record *data);
+public:
+    // Database still runs one operation at a time (see DatabaseWorker.h), so more shards would only cost it:
+    // every save walks all customers in order, which means merging the shards back together (see forEach below)
+    // raise this once bookings actually run in parallel, bench-shards shows what that gains
+    static const int DEFAULT_SHARDS = 1;
+
+    explicit ShardedCustomerStore(int numShards = DEFAULT_SHARDS);
+    // rule of three: the shards clean up after themselves, and copying is disallowed since RBTree can't be copied
+
+    // these all behave like their RBTree counterparts:
+    void insert(Record *data);
+    void erase(Record *data);
+    bool contains(Record *data);
+    Record* get(Record *data);
+    int size();
+    int height(); // of the tallest shard
+    void eraseAll(const std::vector<Record*> &keys);
+    void buildSorted(std::vector<Record*> &sorted);
+
+    // runs func(Record*) for every customer from every shard in sorted order
+    // every shard stays locked the whole time, so func must not use the store itself
+    template<class Func>
+    void forEach(Func &&func);
+
+    inline int numShards() const { return shards.size(); }
+};
+
+// every shard is already sorted on its own, so we only have to repeatedly take the smallest of the shards' next customers
+// every shard gets an iterator, and a tournament tree decides which one is next: the shards play matches in pairs,
+// every inner node remembers the loser of the match played there and the overall winner comes out on top
+// after the winner moves on to its next customer, only the log2(shards) matches on its way back up are replayed
+template<class Func>
+void ShardedCustomerStore::forEach(Func &&func) {
+    std::vector<std::unique_lock<std::mutex>> guards;
+    for (auto &shard : shards) guards.emplace_back(shard->lock); // always locked in the same order
+
+    if (shards.size() == 1) { // nothing to merge
+        shards[0]->tree.forEach(func);
+        return;
+    }
+
+    std::vector<RBTree::iterator> cursors, ends;
+    for (auto &shard : shards) {
+        cursors.push_back(shard->tree.begin());
+        ends.push_back(shard->tree.end());
+    }
+    size_t leaves = 1; // the tree is filled up to a power of two with shards that are always finished
+    while (leaves < shards.size()) leaves *= 2;
+    auto finished = [&](size_t i) { return i >= shards.size() || cursors[i] == ends[i]; };
+    auto beats = [&](size_t a, size_t b) { // does shard a's next customer come before shard b's? finished shards always lose
+        if (finished(a)) return false;
+        if (finished(b)) return true;
+        return (*cursors[a])->compare(*cursors[b]) < 0;
+    };
+
+    // play the first round bottom up, node n's children are nodes 2n and 2n + 1, and the shards are the leaves
+    std::vector<size_t> winners(2 * leaves), losers(leaves);
+    for (size_t i = 0; i < leaves; i++) winners[leaves + i] = i;
+    for (size_t n = leaves - 1; n >= 1; n--) {
+        size_t a = winners[2 * n], b = winners[2 * n + 1];
+        if (beats(b, a)) std::swap(a, b);
+        winners[n] = a;
+        losers[n] = b;
+    }
+
+    size_t winner = winners[1];
+    while (!finished(winner)) {
+        func(*cursors[winner]);
+        ++cursors[winner];
+        for (size_t n = (leaves + winner) / 2; n >= 1; n /= 2)
+            if (beats(losers[n], winner)) std::swap(losers[n], winner);
+    }
+}
+
+#endif // SHARDEDCUSTOMERSTORE_H
@@ -0,0 +1,374 @@
+#include "Snapshot.h"
+#include "Flight.h"
+#include "Customer.h"
+#include "CustomerCache.h"
+#include "Serialization.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const char MAGIC[4] = {'A', 'I', 'R', 'S'};
+static const unsigned char VERSION = 2; // bump whenever the layout changes, so old files are not misread
+static const unsigned char COMPRESSED = 1; // flag: the rest of the file is block compressed
+
+// every Record in the tree (or store) in sorted order, as its actual type
+template<class T, class Tree>
+static std::vector<T*> sortedRecords(Tree &tree) {
+    std::vector<T*> records;
+    records.reserve(tree.size());
+    tree.forEach([&records](Record *r) { records.push_back(static_cast<T*>(r)); });
+    return records;
+}
+
+// strictly increasing, so there are no duplicates either
+template<class T>
+static bool isSorted(const std::vector<T*> &records) {
+    for (size_t i = 1; i < records.size(); i++) {
+        if (records[i - 1]->compare(records[i]) >= 0) return false;
+    }
+    return true;
+}
+
+template<class T, class Tree>
+static void buildTree(Tree &tree, const std::vector<T*> &records) {
+    std::vector<Record*> sorted(records.begin(), records.end());
+    tree.buildSorted(sorted);
+}
+
+bool Snapshot::readHeader(ByteReader &in) {
+    char magic[4];
+    in.getBytes(magic, 4);
+    if (memcmp(magic, MAGIC, 4) != 0 || in.getByte() != VERSION) return false;
+    if (in.getByte() & COMPRESSED) in.startBlocks();
+    return in.good();
+}
+
+bool Snapshot::save(const std::string &path, RBTree &flights, ShardedCustomerStore &customers, bool compress, Offsets &newOffsets) {
+    std::vector<Flight*> flightList = sortedRecords<Flight>(flights);
+    std::vector<Customer*> customerList = sortedRecords<Customer>(customers);
+
+    std::ofstream fout(path, std::ios::binary); // open data file and specify that we are writing binary
+    ByteWriter w(fout);
+    w.putBytes(MAGIC, 4);
+    w.putByte(VERSION);
+    w.putByte(compress ? COMPRESSED : 0);
+    if (compress) w.startBlocks();
+
+    w.putVarint(flightList.size());
+    writeKeyColumns(w, flightList);
+    for (Flight *f : flightList) w.putVarint(payloadSize(*f));
+    for (Flight *f : flightList) writePayload(w, *f);
+
+    w.putVarint(customerList.size());
+    writeKeyColumns(w, customerList);
+    for (Customer *c : customerList) {
+        if (c->resident) c->recordSize = payloadSize(*c); // a stub still knows its size from when it was loaded
+        w.putVarint(c->recordSize);
+    }
+    long long recordsStart = w.position();
+    std::vector<long long> oldOffsets;
+    oldOffsets.reserve(customerList.size());
+    bool copied = true;
+    for (Customer *c : customerList) {
+        long long start = w.position();
+        if (c->resident) writePayload(w, *c);
+        else copied = Customer::cache->copyRecord(c->offset, c->recordSize, w) && copied; // copied over from the old file without decoding it
+        oldOffsets.push_back(c->offset);
+        c->offset = start; // only until the seats are written, see below
+    }
+
+    for (Flight *f : flightList) {
+        w.putVarint(f->getOccupiedCount());
+
+        int previous = -1;
+        f->forEachPassenger([&](int seat, Customer *c) {
+            w.putVarint(seat - previous - 1);
+            w.putVarint(c->offset - recordsStart);
+            previous = seat;
+        });
+    }
+    w.finish();
+    STATS_ADD(bytesSaved, fout.tellp());
+    fout.close(); // closing flushes the last of the file, which can fail too (e.g. the disk is full)
+
+    newOffsets.clear();
+    newOffsets.reserve(customerList.size());
+    for (size_t i = 0; i < customerList.size(); i++) {
+        newOffsets.emplace_back(customerList[i], customerList[i]->offset);
+        customerList[i]->offset = oldOffsets[i];
+    }
+    return copied && !fout.fail();
+}
+
+void Snapshot::useOffsets(const Offsets &offsets) {
+    for (const auto &moved : offsets) moved.first->offset = moved.second;
+}
+
+Snapshot::LoadResult Snapshot::load(const std::string &path, RBTree &flights, ShardedCustomerStore &customers, bool lazy) {
+    std::ifstream fin(path, std::ios::binary); // open data file and specify that we are reading binary
+    if (!fin.good() || fin.peek() == std::ifstream::traits_type::eof()) return MISSING; // an empty file has nothing to lose either
+
+    // an original file can be shorter than the magic string, so it is checked before the reader can fail on it
+    char magic[4] = {};
+    fin.read(magic, 4);
+    fin.clear();
+    fin.seekg(0);
+    ByteReader in(fin);
+    if (memcmp(magic, MAGIC, 4) != 0) return loadOriginal(in, flights, customers) ? UPGRADED : UNREADABLE; // no header at all
+    in.skip(4);
+    int version = in.getByte();
+    if (version == 1) return loadSections(in, flights, customers, false, false) ? UPGRADED : UNREADABLE;
+    if (version != VERSION) return UNREADABLE;
+    if (in.getByte() & COMPRESSED) in.startBlocks();
+    return loadSections(in, flights, customers, lazy, true) ? LOADED : UNREADABLE;
+}
+
+bool Snapshot::loadSections(ByteReader &in, RBTree &flights, ShardedCustomerStore &customers, bool lazy, bool frontCoded) {
+    // every count and size is checked against what is left of the file before anything is allocated for it (see fits),
+    // and nothing is put into the trees until the whole file has been read, so a broken file just leaves them empty
+    std::vector<Flight*> flightList;
+    std::vector<Customer*> customerList;
+    auto discard = [&flightList, &customerList]() {
+        for (Flight *f : flightList) delete f;
+        for (Customer *c : customerList) delete c;
+        return false;
+    };
+
+    unsigned long long count = in.getVarint();
+    if (!in.fits(count)) return false;
+    flightList.resize(count);
+    for (Flight *&f : flightList) f = RecordLayout<Flight>::make();
+    readKeyColumns(in, flightList, frontCoded);
+    for (size_t i = 0; i < flightList.size(); i++) in.getVarint(); // sizes are only needed to skip records
+    for (Flight *f : flightList) {
+        readPayload(in, *f);
+        if (f->getSize() <= 0) return discard(); // a flight always has seats (see Database::addFlight)
+    }
+
+    count = in.getVarint();
+    if (!in.fits(count)) return discard();
+    customerList.resize(count);
+    for (Customer *&c : customerList) c = RecordLayout<Customer>::make();
+    readKeyColumns(in, customerList, frontCoded);
+    for (Customer *c : customerList) {
+        unsigned long long size = in.getVarint();
+        if (!in.fits(size)) return discard();
+        c->recordSize = size;
+    }
+    long long recordsStart = in.position();
+    long long offset = recordsStart;
+    for (Customer *c : customerList) {
+        c->offset = offset;
+        offset += c->recordSize;
+        if (lazy) c->resident = false; // a stub, to be loaded when it is needed
+        else if (in.position() != c->offset) return discard(); // the sizes don't match the records
+        else readPayload(in, *c);
+    }
+    if (lazy && in.fits(offset - in.position())) in.seek(offset);
+    if (in.position() != offset) return discard(); // the records added up are longer than the file, or the sizes are wrong
+
+    // work out every seat before touching any flight, so a bad file leaves the flights as they were
+    struct SeatLink { Flight *flight; int seat; Customer *occupant; };
+    std::vector<SeatLink> links;
+    std::vector<bool> seated(customerList.size(), false); // nobody can sit in two seats
+    Customer key;
+    auto offsetLess = [](const Customer *a, const Customer *b) { return a->offset < b->offset; };
+    bool ok = in.good();
+    for (size_t f = 0; ok && f < flightList.size(); f++) {
+        unsigned long long occupied = in.getVarint();
+        long long seat = -1;
+        for (unsigned long long i = 0; ok && i < occupied; i++) {
+            seat += std::min(in.getVarint(), static_cast<unsigned long long>(flightList[f]->getSize())) + 1; // can't overflow
+            key.offset = recordsStart + in.getVarint();
+            // customers are in the file in sorted order, so their offsets are sorted too
+            auto it = std::lower_bound(customerList.begin(), customerList.end(), &key, offsetLess);
+            ok = in.good() && it != customerList.end() && (*it)->offset == key.offset && seat < flightList[f]->getSize()
+                 && !seated[it - customerList.begin()];
+            if (ok) {
+                links.push_back({flightList[f], static_cast<int>(seat), *it});
+                seated[it - customerList.begin()] = true;
+            }
+        }
+    }
+    if (!ok || !in.good() || !isSorted(flightList) || !isSorted(customerList)) return discard(); // buildSorted relies on the order
+
+    for (const SeatLink &link : links) link.flight->setSeat(link.seat, link.occupant);
+    buildTree(flights, flightList);
+    buildTree(customers, customerList);
+    return true;
+}
+
+// the original format was a dump of both trees (flights, then customers), written by the nodes themselves:
+// a byte saying whether there is a tree at all, then for every node, starting at the root: a colour byte, the Record,
+// and for each of the left and right child, a byte saying whether there is one, followed by that child's own node
+// ints were always 4 bytes (lowest byte first), and strings were their length as such an int, followed by the characters
+// a Flight was its id and size, and a Customer its name, address, phone number, flight id and seat number
+static int getFixedInt(ByteReader &in) {
+    unsigned char c[4];
+    in.getBytes(reinterpret_cast<char*>(c), 4);
+    return static_cast<int>(c[0] | c[1] << 8 | c[2] << 16 | static_cast<unsigned>(c[3]) << 24);
+}
+static bool getFixedString(ByteReader &in, std::string &s) {
+    int length = getFixedInt(in);
+    if (length < 0) return false;
+    s.clear();
+    in.getString(s, length); // checks the length against the rest of the file first
+    return in.good();
+}
+
+// appends the Records of the subtree at the current position to records, in sorted order
+template<class T, class ReadRecord>
+static bool readOriginalNode(ByteReader &in, std::vector<T*> &records, ReadRecord &readRecord, int depth) {
+    if (depth > 128) return false; // far taller than a red-black tree of any size we could load, so the file is broken
+    in.getByte(); // the colour, the tree gets rebuilt anyway
+    T *r = RecordLayout<T>::make();
+    bool ok = readRecord(*r);
+    if (ok && in.getByte()) ok = readOriginalNode(in, records, readRecord, depth + 1); // smaller Records come first
+    records.push_back(r); // even if something went wrong, so that the caller deletes it
+    if (ok && in.getByte()) ok = readOriginalNode(in, records, readRecord, depth + 1);
+    return ok && in.good();
+}
+template<class T, class ReadRecord>
+static bool readOriginalTree(ByteReader &in, std::vector<T*> &records, ReadRecord readRecord) {
+    if (!in.getByte()) return in.good(); // an empty tree
+    // every tree in it was a binary search tree, so anything out of order means a broken file
+    return readOriginalNode(in, records, readRecord, 0) && isSorted(records);
+}
+
+bool Snapshot::loadOriginal(ByteReader &in, RBTree &flights, ShardedCustomerStore &customers) {
+    std::vector<Flight*> flightList;
+    std::vector<Customer*> customerList;
+    bool ok = readOriginalTree(in, flightList, [&in](Flight &f) {
+        bool read = getFixedString(in, f.id);
+        f.size = getFixedInt(in);
+        if (!read || f.size < 0 || !in.good()) return false;
+        RecordLayout<Flight>::loaded(f);
+        return true;
+    });
+    ok = ok && readOriginalTree(in, customerList, [&in](Customer &c) {
+        bool read = getFixedString(in, c.name) && getFixedString(in, c.address) && getFixedString(in, c.phonenum)
+                    && getFixedString(in, c.flightid);
+        c.seatnum = getFixedInt(in);
+        return read && in.good();
+    });
+
+    // seats weren't saved, every customer gets put back into the seat they say they have
+    // the flights aren't in their tree yet, so if this goes wrong, there is nothing to undo
+    Flight key("");
+    auto idLess = [](const Flight *a, const Flight *b) { return a->compare(b) < 0; };
+    for (size_t i = 0; ok && i < customerList.size(); i++) {
+        Customer *c = customerList[i];
+        key.id = c->flightid;
+        auto it = std::lower_bound(flightList.begin(), flightList.end(), &key, idLess);
+        ok = it != flightList.end() && (*it)->id == c->flightid && c->seatnum >= 0 && c->seatnum < (*it)->size
+             && (*it)->getSeat(c->seatnum) == nullptr;
+        if (ok) (*it)->setSeat(c->seatnum, c);
+    }
+    if (!ok) {
+        for (Flight *f : flightList) delete f;
+        for (Customer *c : customerList) delete c;
+        return false;
+    }
+
+    buildTree(flights, flightList);
+    buildTree(customers, customerList);
+    return true;
+}
+
+// a reader with its own stream, so that several parts of the same file can be read at the same time
+struct FileCursor {
+    std::ifstream fin;
+    ByteReader in;
+    FileCursor(const std::string &path, long long position) : fin(path, std::ios::binary), in(fin) {
+        if (Snapshot::readHeader(in)) in.seek(position);
+    }
+};
+
+// a front coded string column (see encodeKeyField), without decoding it
+static void skipKeyColumn(ByteReader &in, size_t count) {
+    for (size_t i = 0; i < count && in.good(); i++) {
+        in.getVarint(); // characters shared with the previous value
+        in.skip(in.getVarint());
+    }
+}
+
+// the sizes column, giving the total size of the payloads that follow it
+static long long sumSizes(ByteReader &in, size_t count) {
+    long long total = 0;
+    for (size_t i = 0; i < count && in.good(); i++) {
+        unsigned long long size = in.getVarint();
+        if (in.fits(size)) total += size;
+    }
+    return in.fits(total) ? total : 0;
+}
+
+bool Snapshot::scan(const std::string &path, const std::function<void(const FlightRow&)> &onFlight,
+                    const std::function<void(const CustomerRow&)> &onCustomer) {
+    // the rows are decoded here field by field, so this has to follow the layouts in Flight.h and Customer.h
+    static_assert(std::tuple_size<decltype(RecordLayout<Flight>::keyFields())>::value == 1
+                  && std::tuple_size<decltype(RecordLayout<Flight>::payloadFields())>::value == 1, "Flight layout changed");
+    static_assert(std::tuple_size<decltype(RecordLayout<Customer>::keyFields())>::value == 2
+                  && std::tuple_size<decltype(RecordLayout<Customer>::payloadFields())>::value == 3, "Customer layout changed");
+
+    // first find where every column starts, skipping over everything else
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin.good()) return false;
+    ByteReader probe(fin);
+    if (!readHeader(probe)) return false;
+
+    size_t numFlights = probe.getVarint();
+    probe.fits(numFlights); // a count the file can't hold makes probe fail, which is checked below
+    long long flightIds = probe.position();
+    skipKeyColumn(probe, numFlights);
+    long long flightPayloadBytes = sumSizes(probe, numFlights);
+    long long flightPayloads = probe.position();
+    probe.skip(flightPayloadBytes);
+
+    size_t numCustomers = probe.getVarint();
+    probe.fits(numCustomers);
+    long long names = probe.position();
+    skipKeyColumn(probe, numCustomers);
+    long long phonenums = probe.position();
+    skipKeyColumn(probe, numCustomers);
+    long long customerPayloadBytes = sumSizes(probe, numCustomers);
+    long long customerPayloads = probe.position();
+    probe.skip(customerPayloadBytes);
+    long long seats = probe.position();
+    if (!probe.good()) return false;
+
+    // then go through the rows, with one reader per column
+    {
+        FileCursor ids(path, flightIds), payloads(path, flightPayloads), seatLists(path, seats);
+        FlightRow row;
+        std::string previous;
+        for (size_t i = 0; i < numFlights; i++) {
+            decodeKeyField(ids.in, row.id, previous);
+            decodeField(payloads.in, row.seats);
+            row.occupied = seatLists.in.getVarint();
+            for (int j = 0; j < 2 * row.occupied && seatLists.in.good(); j++) seatLists.in.getVarint(); // which seats, and who
+            if (!ids.in.good() || !payloads.in.good() || !seatLists.in.good()) return false;
+            onFlight(row);
+            previous.swap(row.id); // the next id is decoded from this one, and row.id is overwritten anyway
+        }
+    }
+    {
+        FileCursor nameColumn(path, names), phoneColumn(path, phonenums), payloads(path, customerPayloads);
+        CustomerRow row;
+        std::string previousName, previousPhone;
+        for (size_t i = 0; i < numCustomers; i++) {
+            decodeKeyField(nameColumn.in, row.name, previousName);
+            decodeKeyField(phoneColumn.in, row.phonenum, previousPhone);
+            decodeField(payloads.in, row.address);
+            decodeField(payloads.in, row.flightId);
+            decodeField(payloads.in, row.seat);
+            if (!nameColumn.in.good() || !phoneColumn.in.good() || !payloads.in.good()) return false;
+            onCustomer(row);
+            previousName.swap(row.name);
+            previousPhone.swap(row.phonenum);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "ShardedCustomerStore.h"
+#include "Serialization.h"
+
+/*
+    The database file (data/data.dat)
+
+    Everything is written in key order, so the tree shapes don't have to be saved:
+    when loading, RBTree::buildSorted puts the sorted records straight back into a balanced tree.
+
+    layout (all numbers are varints, see Serialization.h):
+    - a 4 byte magic string followed by a version byte and a flags byte
+    - if the COMPRESSED flag is set, everything after the header is block compressed (see Serialization.h)
+    - the flights section, then the customers section, each being:
+        number of records
+        the front coded key columns (see writeKeyColumns)
+        the size in bytes of every record's payload
+        every record's payload, one after the other
+    - the seats: for every flight (in the same order as the flights section), the number of occupied seats,
+      then for each occupied seat in increasing order, how many seats were skipped since the previous one
+      and where its occupant's payload starts, counted from the start of the customers' payloads
+
+    since the customers' payload sizes are known before the payloads themselves are read,
+    a lazy load can work out where every customer is on disk and skip all of their payloads (see CustomerCache.h)
+    this works the same way in a compressed file, only the block containing the customer has to be decompressed
+
+    files written by older versions can still be loaded, so nobody loses their database by upgrading:
+    - version 1 is the same, except there is no flags byte and the key columns aren't front coded
+    - the original format had no header at all, it was a dump of both trees node by node (see loadOriginal),
+      the first lazy loading version still wrote that, with its index in a separate file which is simply ignored now
+    they are always loaded eagerly, and should be saved again straight away, since only the current format is ever written
+*/
+class Snapshot {
+public:
+    // where every customer's payload is in a newly saved file
+    typedef std::vector<std::pair<Customer*, long long>> Offsets;
+
+    // returns false if the file couldn't be completely written (including a lazy customer that couldn't be copied over)
+    // customers keep pointing at their records in the old file, since that is still the one CustomerCache reads,
+    // newOffsets is where they are in the new file, to be given to useOffsets once it has replaced the old one
+    static bool save(const std::string &path, RBTree &flights, ShardedCustomerStore &customers, bool compress, Offsets &newOffsets);
+    static void useOffsets(const Offsets &offsets);
+
+    // UPGRADED: the file is in an older format, everything was loaded into memory (see above)
+    // MISSING and UNREADABLE leave the trees empty, UNREADABLE meaning the file is there but broken or from a newer version
+    // (a broken file is always caught before anything is allocated for it, however big the counts and lengths in it are)
+    enum LoadResult { LOADED, UPGRADED, MISSING, UNREADABLE };
+
+    // when lazy is true, Customers are only created as stubs which Customer::cache loads on demand
+    static LoadResult load(const std::string &path, RBTree &flights, ShardedCustomerStore &customers, bool lazy);
+
+    // checks the header at the start of the file, and puts the reader into block mode if the file is compressed
+    static bool readHeader(ByteReader &in);
+
+    // what scan() gives for every record, these are plain copies so scanning never touches the trees or their caches
+    struct FlightRow { std::string id; int seats = 0, occupied = 0; };
+    struct CustomerRow { std::string name, phonenum, address, flightId; int seat = -1; };
+
+    // goes through a saved file without loading it: onFlight is called for every flight, then onCustomer for every customer,
+    // both in sorted order, and the same row object is reused every time
+    // every column is read by its own reader, side by side, so only a few buffers are in memory however big the file is
+    // returns false if the file is missing or isn't a valid snapshot (possibly after some rows were already given)
+    static bool scan(const std::string &path, const std::function<void(const FlightRow&)> &onFlight,
+                     const std::function<void(const CustomerRow&)> &onCustomer);
+
+private:
+    // everything after the header, in the current format or in version 1
+    static bool loadSections(ByteReader &in, RBTree &flights, ShardedCustomerStore &customers, bool lazy, bool frontCoded);
+    static bool loadOriginal(ByteReader &in, RBTree &flights, ShardedCustomerStore &customers);
+};
+
+#endif // SNAPSHOT_H
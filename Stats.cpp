@@ -0,0 +1,53 @@
+#include "Stats.h"
+#include "OperationTrace.h"
+
+#include <cstdio>
+
+#ifdef AIRLINE_STATS
+std::atomic<long long> Stats::lookups(0), Stats::comparisons(0);
+std::atomic<long long> Stats::nodesAllocated(0), Stats::nodesFreed(0);
+std::atomic<long long> Stats::recordsAllocated(0), Stats::recordsFreed(0);
+std::atomic<long long> Stats::customerAccesses(0), Stats::customerFetches(0), Stats::customerEvictions(0);
+std::atomic<long long> Stats::bytesSaved(0);
+
+LatencyHistogram Stats::operations[Operation::NUM_TYPES];
+LatencyHistogram Stats::loads, Stats::saves;
+#endif
+
+std::string Diagnostics::toText() const {
+    std::string text;
+    char line[200];
+    for (const auto &value : values) {
+        snprintf(line, sizeof(line), "%-28s %.6g\n", value.first.c_str(), value.second);
+        text += line;
+    }
+    if (!latencies.empty()) {
+        snprintf(line, sizeof(line), "\n%-28s %8s %10s %10s %10s %10s %10s  (microseconds)\n", "latency", "count", "mean", "p50", "p90", "p99", "max");
+        text += line;
+    }
+    for (const auto &latency : latencies) {
+        snprintf(line, sizeof(line), "%-28s %s\n", latency.first.c_str(), latency.second.summary().c_str());
+        text += line;
+    }
+    return text;
+}
+
+// names are always plain identifiers here, so they don't need any escaping
+std::string Diagnostics::toJson() const {
+    std::string json = "{\n  \"values\": {";
+    char item[300];
+    for (size_t i = 0; i < values.size(); i++) {
+        snprintf(item, sizeof(item), "%s\n    \"%s\": %.17g", i ? "," : "", values[i].first.c_str(), values[i].second);
+        json += item;
+    }
+    json += "\n  },\n  \"latencies_us\": {";
+    for (size_t i = 0; i < latencies.size(); i++) {
+        const LatencyHistogram &h = latencies[i].second;
+        snprintf(item, sizeof(item), "%s\n    \"%s\": {\"count\": %lld, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+                 i ? "," : "", latencies[i].first.c_str(), h.count(), h.mean() / 1000,
+                 h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0, h.max() / 1000.0);
+        json += item;
+    }
+    json += "\n  }\n}\n";
+    return json;
+}
@@ -0,0 +1,69 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "LatencyHistogram.h"
+
+/*
+    Instrumentation
+
+    Counting and timing things costs a little on every operation, so it is only compiled in when
+    AIRLINE_STATS is defined (build with "qmake CONFIG+=stats", see QTTest.pro).
+    Without it, the STATS_ macros below expand to nothing and none of the counters exist.
+
+    Counters are atomic, since the sharded customer store can be used from several threads at once,
+    but the latency histograms are only updated by the Database, which is only used from one thread.
+*/
+#ifdef AIRLINE_STATS
+
+#include <atomic>
+#include <chrono>
+
+struct Stats {
+    static std::atomic<long long> lookups; // searches of an RBTree (insert, erase, contains and get)
+    static std::atomic<long long> comparisons; // Record comparisons made by those searches
+    static std::atomic<long long> nodesAllocated, nodesFreed; // RBNodes
+    static std::atomic<long long> recordsAllocated, recordsFreed; // Flights and Customers, including key objects
+    static std::atomic<long long> customerAccesses, customerFetches, customerEvictions; // see CustomerCache.h
+    static std::atomic<long long> bytesSaved; // size of every database file written, added up
+
+    static LatencyHistogram operations[]; // one per Operation::Type (see OperationTrace.h)
+    static LatencyHistogram loads, saves;
+};
+
+// adds the time from here to the end of the enclosing scope to a histogram
+class StatsTimer {
+private:
+    LatencyHistogram &histogram;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit StatsTimer(LatencyHistogram &histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~StatsTimer() { histogram.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()); }
+    StatsTimer& operator=(const StatsTimer &rhs) = delete;
+    StatsTimer(const StatsTimer &st) = delete;
+};
+
+#define STATS_ADD(counter, n) (Stats::counter.fetch_add((n), std::memory_order_relaxed))
+#define STATS_COUNT(counter) STATS_ADD(counter, 1)
+#define STATS_TIME(histogram) StatsTimer statsTimer(Stats::histogram)
+
+#else
+
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_TIME(histogram) ((void)0)
+
+#endif // AIRLINE_STATS
+
+// a snapshot of named numbers and latency histograms, shown in the GUI or written out as JSON
+struct Diagnostics {
+    std::vector<std::pair<std::string, double>> values;
+    std::vector<std::pair<std::string, LatencyHistogram>> latencies;
+
+    std::string toText() const;
+    std::string toJson() const;
+};
+
+#endif // STATS_H
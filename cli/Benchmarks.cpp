@@ -0,0 +1,129 @@
+#include "Benchmarks.h"
+#include "Customer.h"
+#include "ShardedCustomerStore.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a booking the way MainWindow does it: check the customer isn't already booked, then add them
+static void book(ShardedCustomerStore &store, Customer *customer) {
+    if (store.contains(customer)) delete customer;
+    else store.insert(customer);
+}
+
+void benchShards(int bookingsPerThread) {
+    const int shardCounts[] = {1, 2, 4, 8, 16};
+    const int threadCounts[] = {1, 2, 4, 8};
+
+    printf("bookings per second (%d bookings per thread), hardware threads: %u\n",
+           bookingsPerThread, std::thread::hardware_concurrency());
+    printf("%8s", "shards");
+    for (int threads : threadCounts) printf("%10d thr", threads);
+    printf("\n");
+
+    for (int shards : shardCounts) {
+        printf("%8d", shards);
+        for (int threads : threadCounts) {
+            ShardedCustomerStore store(shards);
+
+            // make every customer up front so only the bookings themselves are timed
+            std::vector<std::vector<Customer*>> work(threads);
+            for (int t = 0; t < threads; t++) {
+                work[t].reserve(bookingsPerThread);
+                for (int i = 0; i < bookingsPerThread; i++) {
+                    std::string name = "Customer " + std::to_string(t) + "-" + std::to_string(i);
+                    work[t].push_back(new Customer(name, "1 Main St", "(555) 555-5555", "AC100", 0));
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> pool;
+            for (int t = 0; t < threads; t++)
+                pool.emplace_back([&store, &work, t]() {
+                    for (Customer *c : work[t]) book(store, c);
+                });
+            for (std::thread &thread : pool) thread.join();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            printf("%14.0f", threads * bookingsPerThread / seconds);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+}
+
+// runs walk a few times and prints the best time per record, the first run also warms up the caches
+template<class Walk>
+static void timeWalk(const char *name, int records, Walk walk) {
+    double best = 1e30;
+    uintptr_t check = 0;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        check = walk();
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    printf("%-28s %8.2f ns per record  (%8.2f ms, check %llu)\n", name, best / records, best / 1e6,
+           static_cast<unsigned long long>(check % 1000));
+}
+
+void benchTraversal(int records) {
+    RBTree tree;
+    ShardedCustomerStore store(16); // the most shards bench-shards tries, to see what merging them costs a walk
+    std::vector<Record*> sorted;
+    for (int i = 0; i < records; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Customer %09d", i); // zero padded, so the numbers are also in sorted order
+        sorted.push_back(new Customer(name, "1 Main St", "(555) 555-5555", "AC100", 0));
+    }
+    tree.buildSorted(sorted);
+    for (int i = 0; i < records; i++) // a second copy for the store, since both trees own their Records
+        store.insert(new Customer(static_cast<Customer*>(sorted[i])->getName(), "1 Main St", "(555) 555-5555", "AC100", 0));
+
+    // the visitor only mixes the addresses together, so the walk itself is what gets measured
+    printf("walking %d customers\n", records);
+    timeWalk("forEach, std::function", records, [&tree]() {
+        uintptr_t sum = 0;
+        std::function<void(Record*)> visit = [&sum](Record *r) { sum += reinterpret_cast<uintptr_t>(r) >> 4; };
+        tree.forEach(visit);
+        return sum;
+    });
+    timeWalk("forEach, lambda", records, [&tree]() {
+        uintptr_t sum = 0;
+        tree.forEach([&sum](Record *r) { sum += reinterpret_cast<uintptr_t>(r) >> 4; });
+        return sum;
+    });
+    timeWalk("range-for", records, [&tree]() {
+        uintptr_t sum = 0;
+        for (Record *r : tree) sum += reinterpret_cast<uintptr_t>(r) >> 4;
+        return sum;
+    });
+    timeWalk("range-for, first 1000 only", std::min(records, 1000), [&tree]() { // per record it actually visits
+        uintptr_t sum = 0;
+        int seen = 0;
+        for (Record *r : tree) {
+            if (++seen > 1000) break;
+            sum += reinterpret_cast<uintptr_t>(r) >> 4;
+        }
+        return sum;
+    });
+    timeWalk("16 shard store forEach", records, [&store]() {
+        uintptr_t sum = 0;
+        store.forEach([&sum](Record *r) { sum += reinterpret_cast<uintptr_t>(r) >> 4; });
+        return sum;
+    });
+
+    RBTree flights; // no flights, so the save is all customers
+    timeWalk("save (16 shard store)", records, [&flights, &store]() {
+        Snapshot::Offsets offsets;
+        Snapshot::save("bench-traversal.dat", flights, store, false, offsets);
+        return static_cast<uintptr_t>(0);
+    });
+    std::remove("bench-traversal.dat");
+}
@@ -0,0 +1,18 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+/*
+    Benchmarks that can be run from the console version of the program (see main.cpp)
+    each one prints its results as a table on standard output
+*/
+
+// books customers from several threads at once into a ShardedCustomerStore,
+// for every combination of shard count and thread count, and prints the bookings per second
+void benchShards(int bookingsPerThread);
+
+// times a full in-order walk over that many customers, with the same cheap visitor every time:
+// forEach with a std::function visitor (how every walk used to go), forEach with a lambda, range-for over the iterators,
+// and the sharded store's merged walk, then a save, which walks every flight and customer
+void benchTraversal(int records);
+
+#endif // BENCHMARKS_H
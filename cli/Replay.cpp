@@ -0,0 +1,155 @@
+#include "Replay.h"
+#include "Database.h"
+#include "LatencyHistogram.h"
+#include "OperationTrace.h"
+#include "Stats.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// run a single operation the way MainWindow would
+static void run(Database &db, const Operation &op) {
+    std::string manifest;
+    Customer *customer;
+    std::vector<Customer*> matches;
+    int seat;
+    switch (op.type) {
+    case Operation::ADD_FLIGHT: db.addFlight(op.flightId, op.number); break;
+    case Operation::REMOVE_FLIGHT: db.removeFlight(op.flightId); break;
+    case Operation::QUERY_FLIGHT: db.queryFlight(op.flightId, op.occupiedOnly, op.sortByName, manifest); break;
+    case Operation::BOOK: db.book(op.name, op.address, op.phonenum, op.flightId, op.number); break;
+    case Operation::FIND: db.find(op.name, op.phonenum, customer); break; // loads the customer's full details too
+    case Operation::CANCEL: db.cancel(op.name, op.phonenum); break;
+    case Operation::BOOK_ANY_SEAT: db.bookAnySeat(op.name, op.address, op.phonenum, op.flightId, seat); break;
+    case Operation::BOOK_GROUP: db.bookGroup(op.group, op.flightId, seat); break;
+    case Operation::SEARCH_NAME: db.searchNames(op.name, op.number, matches); break;
+    }
+}
+
+static bool copyFile(const std::string &from, const std::string &to) {
+    std::ifstream fin(from, std::ios::binary);
+    std::ofstream fout(to, std::ios::binary);
+    if (!fin.good() || !fout.good()) return false;
+    fout << fin.rdbuf();
+    return fout.good();
+}
+
+bool replay(const ReplayOptions &options) {
+    TraceReader trace(options.tracePath);
+    if (!trace.good()) {
+        fprintf(stderr, "can't read trace %s\n", options.tracePath.c_str());
+        return false;
+    }
+    std::remove(options.scratchPath.c_str());
+    if (!options.startingDatabase.empty() && !copyFile(options.startingDatabase, options.scratchPath)) {
+        fprintf(stderr, "can't copy %s\n", options.startingDatabase.c_str());
+        return false;
+    }
+
+    Database db(options.scratchPath);
+    if (!db.getLoadProblem().empty()) {
+        fprintf(stderr, "%s\n", db.getLoadProblem().c_str());
+        return false;
+    }
+    std::vector<LatencyHistogram> histograms(Operation::NUM_TYPES);
+
+    auto start = std::chrono::steady_clock::now();
+    Operation op;
+    while (trace.next(op)) {
+        if (options.timed) std::this_thread::sleep_until(start + std::chrono::microseconds(op.time));
+        auto before = std::chrono::steady_clock::now();
+        run(db, op);
+        histograms[op.type].add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LatencyHistogram all;
+    printf("%-14s %8s %10s %10s %10s %10s %10s  (microseconds)\n", "operation", "count", "mean", "p50", "p90", "p99", "max");
+    for (int type = Operation::ADD_FLIGHT; type < Operation::NUM_TYPES; type++) {
+        if (histograms[type].count() == 0) continue;
+        printf("%-14s %s\n", Operation::typeName(static_cast<Operation::Type>(type)), histograms[type].summary().c_str());
+        all.merge(histograms[type]);
+    }
+    printf("%-14s %s\n", "all", all.summary().c_str());
+    printf("%lld operations in %.2f s (%.0f per second)\n\n", all.count(), seconds, all.count() / seconds);
+
+    Diagnostics diagnostics = db.diagnostics();
+    printf("%s", diagnostics.toText().c_str());
+    if (options.jsonPath.empty()) return true;
+
+    // the replay's own measurements go first, named so they can't be mixed up with the database's
+    diagnostics.values.insert(diagnostics.values.begin(), {"replay_seconds", seconds});
+    std::vector<std::pair<std::string, LatencyHistogram>> replayed;
+    for (int type = Operation::ADD_FLIGHT; type < Operation::NUM_TYPES; type++)
+        if (histograms[type].count() > 0)
+            replayed.push_back({std::string("replay_") + Operation::typeName(static_cast<Operation::Type>(type)), histograms[type]});
+    replayed.push_back({"replay_all", all});
+    diagnostics.latencies.insert(diagnostics.latencies.begin(), replayed.begin(), replayed.end());
+
+    std::ofstream json(options.jsonPath);
+    json << diagnostics.toJson();
+    return json.good();
+}
+
+bool generateTrace(const std::string &tracePath, int numOperations) {
+    // recording through an actual Database keeps the trace valid (bookings go to free seats and so on)
+    std::string scratchPath = tracePath + ".db";
+    std::remove(scratchPath.c_str());
+    bool ok;
+    {
+        Database db(scratchPath);
+        ok = db.startRecording(tracePath);
+        std::mt19937 rng(12345); // fixed seed, so the same trace comes out every time
+
+        const int NUM_FLIGHTS = 20, SEATS = 50;
+        auto flightId = [](int f) { return "AC" + std::to_string(100 + f); };
+        auto customerName = [](int c) { return "Customer " + std::to_string(c); };
+        const std::string phonenum = "(555) 555-5555";
+        for (int f = 0; f < NUM_FLIGHTS; f++) db.addFlight(flightId(f), SEATS);
+
+        int nextCustomer = 0;
+        std::string manifest;
+        Customer *customer;
+        std::vector<Customer*> matches;
+        int seat;
+        for (int i = NUM_FLIGHTS; ok && i < numOperations; i++) {
+            int roll = rng() % 100;
+            int someone = nextCustomer == 0 ? 0 : rng() % nextCustomer;
+            if (roll < 30) {
+                int c = nextCustomer++;
+                db.book(customerName(c), std::to_string(c) + " Main St", phonenum, flightId(rng() % NUM_FLIGHTS), rng() % SEATS);
+            }
+            else if (roll < 37) {
+                int c = nextCustomer++;
+                db.bookAnySeat(customerName(c), std::to_string(c) + " Main St", phonenum, flightId(rng() % NUM_FLIGHTS), seat);
+            }
+            else if (roll < 40) { // a group of 2 to 6 people sitting together
+                std::vector<Passenger> group(2 + rng() % 5);
+                for (Passenger &p : group) {
+                    int c = nextCustomer++;
+                    p = {customerName(c), std::to_string(c) + " Main St", phonenum};
+                }
+                db.bookGroup(group, flightId(rng() % NUM_FLIGHTS), seat);
+            }
+            else if (roll < 65) db.find(customerName(someone), phonenum, customer);
+            else if (roll < 70) { // part of a name, sometimes with a typo
+                std::string query = customerName(someone).substr(0, 10 + rng() % 3);
+                if (rng() % 2) query[rng() % query.size()] = 'x';
+                db.searchNames(query, 20, matches);
+            }
+            else if (roll < 90) db.queryFlight(flightId(rng() % NUM_FLIGHTS), rng() % 2, rng() % 2, manifest);
+            else if (roll < 99) db.cancel(customerName(someone), phonenum);
+            else {
+                int f = rng() % NUM_FLIGHTS;
+                db.removeFlight(flightId(f));
+                db.addFlight(flightId(f), SEATS);
+            }
+        }
+    }
+    std::remove(scratchPath.c_str());
+    return ok;
+}
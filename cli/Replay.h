@@ -0,0 +1,31 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string>
+
+/*
+    Headless replay of a recorded trace (see OperationTrace.h)
+
+    The operations are run against a scratch copy of the database, through the same Database code the GUI uses,
+    and every operation is timed, then a latency histogram is printed for every type of operation,
+    along with the database's diagnostics (see Stats.h).
+    By default operations are run back to back as fast as possible,
+    with timed set they are spaced out the way they were when they were recorded.
+*/
+struct ReplayOptions {
+    std::string tracePath;
+    std::string startingDatabase; // copied to start from, or empty to start from an empty database
+    std::string scratchPath = "replay.dat"; // the database the replay works on, removed first
+    bool timed = false;
+    std::string jsonPath; // if set, the latencies and the database's diagnostics are also written here as JSON
+};
+
+// returns false if the trace or the starting database can't be read
+bool replay(const ReplayOptions &options);
+
+// writes a trace of random operations, for when there's no recorded one
+// roughly a few flights, lots of bookings (some picking their own seats, some for groups), finds and queries,
+// and the odd cancellation
+bool generateTrace(const std::string &tracePath, int numOperations);
+
+#endif // REPLAY_H
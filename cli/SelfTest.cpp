@@ -0,0 +1,1019 @@
+#include "SelfTest.h"
+#include "RBTree.h"
+#include "Customer.h"
+#include "CustomerCache.h"
+#include "Database.h"
+#include "Exporter.h"
+#include "Flight.h"
+#include "ManifestCache.h"
+#include "NameIndex.h"
+#include "OperationTrace.h"
+#include "SeatAllocator.h"
+#include "SeatMap.h"
+#include "ShardedCustomerStore.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
+
+static int failures = 0; // failed CHECKs in the current check
+
+// records a failure instead of stopping, so one run shows everything that is wrong
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            failures++; \
+            printf("    failed: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+        } \
+    } while (false)
+
+// the smallest possible Record, so millions of them fit in memory and comparisons are cheap
+class Key : public Record {
+public:
+    int value;
+    Key(int value) : value(value) {}
+    int compare(const Record *that) const override {
+        int other = static_cast<const Key*>(that)->value;
+        return value < other ? -1 : value > other;
+    }
+};
+
+static int keyOf(Record *r) { return static_cast<Key*>(r)->value; }
+
+// buildSorted past 2^21 Records (where the old int arithmetic overflowed), then random inserts and erases
+static void checkTree() {
+    std::mt19937 rng(26);
+    for (int n : {0, 1, 2, 3, 7, 8, 26, 27, 1000, 2200000}) {
+        std::vector<Record*> sorted;
+        sorted.reserve(n);
+        for (int i = 0; i < n; i++) sorted.push_back(new Key(2 * i)); // even values, so odd ones are never in the tree
+        RBTree tree;
+        tree.buildSorted(sorted);
+        CHECK(tree.size() == n);
+        CHECK(tree.isValid());
+
+        std::set<int> truth;
+        for (int i = 0; i < n; i++) truth.insert(2 * i);
+        int steps = n < 200000 ? n : 200000;
+        for (int i = 0; i < steps; i++) {
+            int value = rng() % (2 * n + 2);
+            Key key(value);
+            if (rng() % 2) {
+                CHECK(tree.contains(&key) == (truth.count(value) == 1));
+                tree.erase(&key);
+                truth.erase(value);
+            } else if (truth.insert(value).second) {
+                tree.insert(new Key(value));
+            }
+        }
+        CHECK(tree.size() == static_cast<int>(truth.size()));
+        CHECK(tree.isValid());
+        auto expected = truth.begin();
+        bool same = true;
+        for (Record *r : tree) same = same && expected != truth.end() && keyOf(r) == *expected++;
+        CHECK(same && expected == truth.end());
+    }
+}
+
+// eraseAll with few and with many keys, keys which are the tree's own Records, keys which aren't in the tree and repeated keys
+static void checkEraseAll() {
+    std::mt19937 rng(27);
+    for (int round = 0; round < 400; round++) {
+        int n = round == 0 ? 0 : rng() % 3000;
+        std::set<int> truth;
+        std::vector<Record*> sorted;
+        for (int i = 0; i < n; i++) truth.insert(rng() % 5000);
+        for (int value : truth) sorted.push_back(new Key(value));
+        RBTree tree;
+        tree.buildSorted(sorted);
+
+        int k = round % 2 ? rng() % 50 : rng() % 3000; // a small flight, or most of the tree
+        std::vector<Record*> keys;
+        std::vector<Key*> separate; // keys we own, as opposed to ones which are the tree's own Records
+        for (int i = 0; i < k; i++) {
+            int value = rng() % 5000;
+            Key key(value);
+            Record *inTree = tree.get(&key);
+            if (inTree != nullptr && rng() % 2) keys.push_back(inTree);
+            else {
+                separate.push_back(new Key(value));
+                keys.push_back(separate.back());
+            }
+            if (rng() % 8 == 0) keys.push_back(keys.back()); // the same key twice
+            truth.erase(value);
+        }
+        tree.eraseAll(keys);
+        for (Key *key : separate) delete key;
+
+        CHECK(tree.size() == static_cast<int>(truth.size()));
+        CHECK(tree.isValid());
+        auto expected = truth.begin();
+        bool same = true;
+        for (Record *r : tree) same = same && expected != truth.end() && keyOf(r) == *expected++;
+        CHECK(same && expected == truth.end());
+
+        // the tree must still work normally afterwards
+        for (int i = 0; i < 100; i++) {
+            int value = rng() % 5000;
+            Key key(value);
+            if (truth.insert(value).second) tree.insert(new Key(value));
+            else if (rng() % 2) {
+                tree.erase(&key);
+                truth.erase(value);
+            }
+        }
+        CHECK(tree.size() == static_cast<int>(truth.size()));
+        CHECK(tree.isValid());
+    }
+}
+
+// random bookings and cancellations, filling flights up and emptying them again so they switch between sparse and dense
+static void checkSeatMap() {
+    std::mt19937 rng(35);
+    std::vector<Customer*> people;
+    for (int i = 0; i < 300; i++) people.push_back(new Customer("Customer " + std::to_string(i), "", "", "", 0));
+
+    for (int capacity : {1, 3, 10, 50, 1000, 20000}) {
+        SeatMap seats(capacity);
+        std::map<int, Customer*> truth;
+        bool wasDense = false, wasSparse = false;
+        // long enough phases that booking fills past a quarter and cancelling empties below an eighth
+        int phase = std::max(4000, 2 * capacity);
+        for (int step = 0; step < 5 * phase; step++) {
+            int seat = rng() % capacity;
+            Customer *c = (step / phase) % 2 == 0 && rng() % 3 != 0 ? people[rng() % people.size()] : nullptr;
+            seats.set(seat, c);
+            if (c) truth[seat] = c;
+            else truth.erase(seat);
+            if (seats.isDense()) wasDense = true;
+            else if (wasDense) wasSparse = true; // sparse again after being dense
+
+            if (step % (phase / 50) != 0) continue;
+            CHECK(seats.occupied() == static_cast<int>(truth.size()));
+            bool same = true;
+            for (int i = 0; i < capacity; i++) {
+                auto it = truth.find(i);
+                same = same && seats.get(i) == (it == truth.end() ? nullptr : it->second);
+            }
+            auto expected = truth.begin();
+            seats.forEachOccupied([&](int i, Customer *occupant) {
+                same = same && expected != truth.end() && expected->first == i && expected->second == occupant;
+                ++expected;
+            });
+            CHECK(same && expected == truth.end());
+
+            SeatMap copy(seats), assigned(1);
+            assigned = seats;
+            for (int i = 0; i < capacity; i++) same = same && copy.get(i) == seats.get(i) && assigned.get(i) == seats.get(i);
+            CHECK(same && copy.occupied() == seats.occupied() && assigned.occupied() == seats.occupied());
+        }
+        // flights with fewer than 8 seats go dense on the first booking and stay that way
+        if (capacity >= 8) CHECK(wasDense && wasSparse);
+    }
+    for (Customer *c : people) delete c;
+}
+
+// compares longestFreeRun, firstFit and bestFit with a scan over the seats, the way Flight::setSeat drives the allocator
+static void checkSeatAllocator() {
+    std::mt19937 rng(36);
+    for (int capacity : {1, 2, 3, 7, 16, 50, 333, 5000}) {
+        SeatAllocator allocator(capacity);
+        std::vector<bool> taken(capacity, false);
+        for (int step = 0; step < 30000; step++) {
+            int seat = rng() % capacity;
+            bool take = (step / 3000) % 2 == 0 ? rng() % 4 != 0 : rng() % 4 == 0;
+            if (take && !taken[seat]) allocator.occupy(seat);
+            else if (!take && taken[seat]) allocator.free(seat);
+            taken[seat] = take;
+
+            if (step % (capacity > 1000 ? 211 : 7) != 0) continue;
+            std::vector<std::pair<int, int>> runs; // (start, length) of every maximal free run
+            int longest = 0;
+            for (int i = 0; i < capacity;) {
+                if (taken[i]) {
+                    i++;
+                    continue;
+                }
+                int end = i;
+                while (end < capacity && !taken[end]) end++;
+                runs.push_back(std::make_pair(i, end - i));
+                longest = std::max(longest, end - i);
+                i = end;
+            }
+            CHECK(allocator.longestFreeRun() == longest);
+            bool same = true;
+            for (int k = 1; k <= std::min(capacity, longest + 2); k++) {
+                int first = -1, best = -1, bestLength = capacity + 1;
+                for (const auto &run : runs) {
+                    if (run.second < k) continue;
+                    if (first == -1) first = run.first;
+                    if (run.second < bestLength) {
+                        bestLength = run.second;
+                        best = run.first;
+                    }
+                }
+                same = same && allocator.firstFit(k) == first && allocator.bestFit(k) == best;
+            }
+            CHECK(same);
+            SeatAllocator copy(allocator);
+            CHECK(copy.longestFreeRun() == longest && copy.firstFit(1) == allocator.firstFit(1));
+        }
+        for (int i = 0; i < capacity; i++) {
+            if (taken[i]) allocator.free(i);
+        }
+        CHECK(allocator.longestFreeRun() == capacity && allocator.firstFit(capacity) == 0);
+    }
+}
+
+static std::string lowerCase(std::string s) {
+    for (char &c : s) c = tolower(static_cast<unsigned char>(c));
+    return s;
+}
+
+// the textbook dynamic programming edit distance, without any of NameIndex's shortcuts
+static int editDistance(const std::string &a, const std::string &b) {
+    std::vector<std::vector<int>> d(a.size() + 1, std::vector<int>(b.size() + 1));
+    for (size_t i = 0; i <= a.size(); i++) d[i][0] = i;
+    for (size_t j = 0; j <= b.size(); j++) d[0][j] = j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        for (size_t j = 1; j <= b.size(); j++) {
+            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (a[i - 1] != b[j - 1])});
+        }
+    }
+    return d[a.size()][b.size()];
+}
+
+// random inserts and erases of similar names, with every kind of search compared against a scan of all customers
+static void checkNameIndex() {
+    std::mt19937 rng(37);
+    const char *firstNames[] = {"Anna", "Bob", "Carla", "Dmitri", "Eve", "Farah", "Gus", "Hana", "Ivan", "Jo", "Kim", "Li"};
+    const char *lastNames[] = {"Smith", "Smyth", "Jones", "Nguyen", "O'Brien", "Garcia", "Lee", "Kowalski", "Ng", "Ali"};
+    std::vector<Customer*> everyone;
+    NameIndex index;
+
+    for (int round = 0; round < 3000; round++) {
+        int op = rng() % 10;
+        if (op < 6 || everyone.empty()) {
+            std::string name = std::string(firstNames[rng() % 12]) + (rng() % 2 ? " " : "") + lastNames[rng() % 10];
+            if (rng() % 3 == 0) name[rng() % name.size()] = 'a' + rng() % 26;
+            Customer *c = new Customer(name, "", std::to_string(rng()), "", 0);
+            everyone.push_back(c);
+            index.insert(c);
+            continue;
+        }
+        if (op < 9) {
+            size_t i = rng() % everyone.size();
+            index.erase(everyone[i]);
+            delete everyone[i];
+            everyone[i] = everyone.back();
+            everyone.pop_back();
+            continue;
+        }
+
+        std::string query = rng() % 2 ? std::string(lastNames[rng() % 10]) : std::string(firstNames[rng() % 12]).substr(0, 1 + rng() % 3);
+        if (rng() % 2 && query.size() > 1) query[rng() % query.size()] = 'a' + rng() % 26;
+        if (rng() % 4 == 0) query = lowerCase(query).substr(rng() % query.size());
+        std::string lower = lowerCase(query);
+
+        auto matches = [&](std::function<bool(const std::string&)> test) {
+            std::multiset<Customer*> found;
+            for (Customer *c : everyone) {
+                if (test(lowerCase(c->getName()))) found.insert(c);
+            }
+            return found;
+        };
+        auto asSet = [](const std::vector<Customer*> &found) { return std::multiset<Customer*>(found.begin(), found.end()); };
+
+        CHECK(asSet(index.prefix(query, everyone.size())) == matches([&](const std::string &name) { return name.compare(0, lower.size(), lower) == 0; }));
+        CHECK(asSet(index.substring(query, everyone.size())) == matches([&](const std::string &name) { return name.find(lower) != std::string::npos; }));
+        for (int distance = 1; distance <= 2; distance++) {
+            std::vector<Customer*> found = index.fuzzy(query, distance, everyone.size());
+            CHECK(asSet(found) == matches([&](const std::string &name) { return editDistance(name, lower) <= distance; }));
+            bool closestFirst = true;
+            for (size_t i = 1; i < found.size(); i++) {
+                closestFirst = closestFirst && editDistance(lowerCase(found[i - 1]->getName()), lower) <= editDistance(lowerCase(found[i]->getName()), lower);
+            }
+            CHECK(closestFirst);
+        }
+        CHECK(index.substring(query, 3).size() <= 3);
+        std::vector<Customer*> found = index.search(query, 10);
+        CHECK(found.size() <= 10 && std::set<Customer*>(found.begin(), found.end()).size() == found.size()); // no one twice
+    }
+    for (Customer *c : everyone) {
+        index.erase(c);
+        delete c;
+    }
+    CHECK(index.size() == 0);
+}
+
+// forEach, iterators both ways and eraseIf against a std::set, then the sharded store's merged forEach
+static void checkIterators() {
+    std::mt19937 rng(40);
+    for (int round = 0; round < 200; round++) {
+        RBTree tree;
+        std::set<int> truth;
+        int n = round == 0 ? 0 : rng() % 300; // the first tree is empty
+        for (int i = 0; i < n; i++) {
+            int value = rng() % 500;
+            if (truth.insert(value).second) tree.insert(new Key(value));
+        }
+        for (int i = 0; i < n / 3; i++) {
+            int value = rng() % 500;
+            Key key(value);
+            tree.erase(&key);
+            truth.erase(value);
+        }
+        std::vector<int> expected(truth.begin(), truth.end()), walked;
+
+        for (Record *r : tree) walked.push_back(keyOf(r));
+        CHECK(walked == expected);
+        walked.clear();
+        tree.forEach([&walked](Record *r) { walked.push_back(keyOf(r)); });
+        CHECK(walked == expected);
+        walked.clear();
+        for (RBTree::iterator it = tree.end(); it != tree.begin();) walked.push_back(keyOf(*--it));
+        CHECK(std::equal(walked.rbegin(), walked.rend(), expected.begin(), expected.end()));
+        CHECK(std::distance(tree.begin(), tree.end()) == static_cast<long>(expected.size()));
+
+        int seen = 0;
+        for (Record *r : tree) {
+            (void)r;
+            if (++seen == 5) break;
+        }
+        CHECK(seen == std::min(5, static_cast<int>(expected.size())));
+
+        if (!expected.empty()) {
+            RBTree::iterator it = tree.begin();
+            size_t position = 0;
+            bool same = true;
+            for (int step = 0; step < 200; step++) {
+                if (rng() % 2 && position + 1 < expected.size()) {
+                    ++it;
+                    position++;
+                } else if (position > 0) {
+                    --it;
+                    position--;
+                }
+                same = same && keyOf(*it) == expected[position];
+            }
+            CHECK(same);
+        }
+
+        tree.eraseIf([](Record *r) { return keyOf(r) % 2 == 0; });
+        expected.erase(std::remove_if(expected.begin(), expected.end(), [](int value) { return value % 2 == 0; }), expected.end());
+        walked.clear();
+        for (Record *r : tree) walked.push_back(keyOf(r));
+        CHECK(walked == expected);
+        CHECK(tree.isValid());
+    }
+
+    for (int shards : {1, 3, 16}) {
+        ShardedCustomerStore store(shards);
+        std::set<std::string> names;
+        for (int i = 0; i < 2000; i++) {
+            std::string name = "Customer " + std::to_string(rng() % 100000);
+            if (names.insert(name).second) store.insert(new Customer(name, "", "", "", 0));
+        }
+        std::vector<std::string> walked;
+        store.forEach([&walked](Record *r) { walked.push_back(static_cast<Customer*>(r)->getName()); });
+        CHECK(walked == std::vector<std::string>(names.begin(), names.end()));
+    }
+}
+
+// the file checks write to the system's temporary folder, and remove what they wrote afterwards
+static std::string tempFile(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / ("airline-self-test-" + name)).string();
+}
+
+static void writeFile(const std::string &path, const std::string &bytes) {
+    std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream fin(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+}
+
+// a database with flights of various sizes and customers in some of their seats, saved at path
+static void fillDatabase(const std::string &path, int numFlights, std::mt19937 &rng) {
+    std::remove(path.c_str());
+    Database db(path);
+    for (int f = 0; f < numFlights; f++) {
+        std::string id = "AC" + std::to_string(100 + f);
+        int seats = 1 + rng() % 60;
+        db.addFlight(id, seats);
+        for (int seat = 0; seat < seats; seat++) {
+            if (rng() % 3 != 0) continue;
+            std::string n = std::to_string(f * 100 + seat);
+            db.book("Customer " + n, n + " Main St, Springfield", "(555) 555-" + n, id, seat);
+        }
+    }
+}
+
+// damaged files have to be rejected as a whole, without crashing or allocating memory for sizes the file can't hold
+static void checkCorruptFiles() {
+    std::mt19937 rng(28);
+    std::string path = tempFile("corrupt.dat");
+    auto load = [&path](const std::string &bytes, bool lazy) {
+        writeFile(path, bytes);
+        RBTree flights;
+        ShardedCustomerStore customers(1);
+        Snapshot::LoadResult result = Snapshot::load(path, flights, customers, lazy);
+        // a file is either loaded completely or not at all
+        CHECK(result == Snapshot::LOADED || (flights.size() == 0 && customers.size() == 0));
+        CHECK(flights.isValid());
+        return result;
+    };
+
+    // hand-made files in the current format: a header without compression, then the flights and customers sections
+    const std::string header("AIRS\x02\x00", 6);
+    const std::string huge("\xff\xff\xff\xff\xff\xff\xff\xff\x7f", 9); // a varint of almost 2^63
+    const std::string noCustomers("\x00\x00", 2); // no customers, no seats
+    // one flight "A" with 3 seats: the id (nothing shared with the previous one, 1 new character), payload size, size
+    const std::string flightA("\x01\x00\x01" "A" "\x01\x06", 6);
+    CHECK(load(header + flightA + noCustomers, false) == Snapshot::LOADED); // so the ones below only fail for one reason
+    CHECK(load(header + huge, false) == Snapshot::UNREADABLE); // number of flights
+    CHECK(load(header + "\x01\x00" + huge, false) == Snapshot::UNREADABLE); // length of a flight id
+    CHECK(load(header + std::string("\x01\x00\x01" "A" "\x01\x00", 6) + noCustomers, false) == Snapshot::UNREADABLE); // 0 seats
+    CHECK(load(header + std::string("\x01\x00\x01" "A" "\x01\x05", 6) + noCustomers, false) == Snapshot::UNREADABLE); // -3 seats
+    CHECK(load(header + flightA + "\x01" + huge, true) == Snapshot::UNREADABLE); // number of customers
+    CHECK(load(header + flightA + std::string("\x01\x00\x01" "N" "\x00\x01" "P", 7) + huge, true) == Snapshot::UNREADABLE); // record size
+    CHECK(load(std::string("AIRS\x02\x01", 6) + std::string(8, '\0') + huge.substr(0, 8) + std::string(8, '\0'), false)
+          == Snapshot::UNREADABLE); // a compressed file with a block index of 2^63 blocks
+
+    // the Database doesn't touch a file it can't read, and says why
+    std::string broken = header + huge;
+    writeFile(path, broken);
+    {
+        Database db(path);
+        CHECK(!db.getLoadProblem().empty());
+        CHECK(db.addFlight("AC100", 10) == Database::DISK_ERROR);
+    }
+    CHECK(readFile(path) == broken);
+
+    // every way of cutting off a real file, and random bytes changed in it, compressed and not
+    fillDatabase(path, 20, rng);
+    std::string plain = readFile(path), compressed;
+    {
+        RBTree flights;
+        ShardedCustomerStore customers(1);
+        CHECK(Snapshot::load(path, flights, customers, false) == Snapshot::LOADED);
+        Snapshot::Offsets offsets;
+        CHECK(Snapshot::save(path, flights, customers, true, offsets));
+        compressed = readFile(path);
+    }
+    for (const std::string &file : {plain, compressed}) {
+        for (size_t length = 0; length < file.size(); length += 1 + rng() % 16) {
+            CHECK(load(file.substr(0, length), length % 2) != Snapshot::LOADED || length == file.size());
+        }
+        for (int i = 0; i < 300; i++) {
+            std::string damaged = file;
+            for (int j = 0; j < 1 + i % 4; j++) damaged[rng() % damaged.size()] ^= 1 << rng() % 8;
+            load(damaged, i % 2);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// a cached manifest has to be exactly what rendering it again would give, whatever changed on the flight since:
+// seats through Flight::setSeat, and passengers' details through the Customer setters
+static void checkManifestCache() {
+    std::mt19937 rng(30);
+    ManifestCache cache(4096); // small enough that manifests get dropped for the budget too
+    Flight::manifests = &cache;
+    {
+        std::vector<std::unique_ptr<Customer>> people; // the flights only point at them, so they are deleted after the flights
+        std::vector<std::unique_ptr<Flight>> flights;
+        for (int f = 0; f < 8; f++) flights.emplace_back(new Flight("AC" + std::to_string(100 + f), 1 + rng() % 40));
+
+        // what the manifest would be without the cache
+        auto render = [](const Flight *f, int view) {
+            return view == ManifestCache::SORTED_BY_NAME ? f->toSortedString() : f->toString(view == ManifestCache::OCCUPIED_ONLY);
+        };
+        auto fresh = [&render, &cache](const Flight *f, int view) {
+            Flight::manifests = nullptr;
+            std::string text = render(f, view);
+            Flight::manifests = &cache;
+            return text;
+        };
+
+        for (int step = 0; step < 20000; step++) {
+            Flight *f = flights[rng() % flights.size()].get();
+            int seat = rng() % f->getSize();
+            Customer *c = f->getSeat(seat);
+            std::string n = std::to_string(step);
+            switch (rng() % 6) {
+            case 0:
+                if (c) f->setSeat(seat, nullptr);
+                else {
+                    people.emplace_back(new Customer("Customer " + n, n + " Main St", "(555) 555-" + n, f->getId(), seat));
+                    f->setSeat(seat, people.back().get());
+                }
+                break;
+            case 1: if (c) c->setName("Renamed " + n); break;
+            case 2: if (c) c->setAddress(n + " Side St"); break;
+            case 3: if (c) c->setPhoneNumber("(555) 000-" + n); break;
+            case 4: { // a copy is a different Flight with the same id, it must never be given the original's text
+                Flight copy(*f);
+                int view = rng() % 3;
+                CHECK(render(&copy, view) == fresh(&copy, view));
+                break;
+            }
+            default: break;
+            }
+            int view = rng() % 3;
+            CHECK(render(f, view) == fresh(f, view));
+        }
+        CHECK(cache.hits() > 1000 && cache.bytesUsed() <= 4096);
+    }
+    Flight::manifests = nullptr;
+}
+
+// a customer as one line, the same whether it comes from the file or from a Customer
+static std::string describe(const std::string &name, const std::string &phonenum, const std::string &address,
+                            const std::string &flightId, int seat) {
+    return name + ", " + phonenum + ", " + address + ", " + flightId + ", " + std::to_string(seat);
+}
+static std::string describe(const Customer *c) {
+    return describe(c->getName(), c->getPhoneNumber(), c->getAddress(), c->getFlightId(), c->getSeatNum());
+}
+
+// every customer in a saved file by name and phone number, read without loading the file (see Snapshot::scan)
+static std::map<std::string, std::string> savedCustomers(const std::string &path) {
+    std::map<std::string, std::string> saved;
+    Snapshot::scan(path, [](const Snapshot::FlightRow&) {}, [&saved](const Snapshot::CustomerRow &c) {
+        saved[c.name + ", " + c.phonenum] = describe(c.name, c.phonenum, c.address, c.flightId, c.seat);
+    });
+    return saved;
+}
+
+// lazy customers have to come back with the details they were saved with, without the cache growing past its capacity,
+// and a record that can't be read has to be reported instead of being shown blank, until the file can be read again
+static void checkLazyCustomers() {
+    std::mt19937 rng(26);
+    std::string path = tempFile("lazy.dat");
+    fillDatabase(path, 40, rng);
+    std::map<std::string, std::string> saved = savedCustomers(path);
+    std::string file = readFile(path);
+    CHECK(file.size() > 4 * 4096); // bigger than what a reader buffers, see below
+    auto savedAs = [&saved](const Customer *c) { return saved[c->getName() + ", " + c->getPhoneNumber()]; };
+
+    CustomerCache cache(8);
+    Customer::cache = &cache;
+    cache.open(path);
+    {
+        RBTree flights;
+        ShardedCustomerStore customers(1);
+        CHECK(Snapshot::load(path, flights, customers, true) == Snapshot::LOADED);
+        std::vector<Customer*> all;
+        customers.forEach([&all](Record *r) { all.push_back(static_cast<Customer*>(r)); });
+        CHECK(all.size() == saved.size() && all.size() > 100);
+        CHECK(cache.residentCount() == 0);
+
+        for (int i = 0; i < 2000; i++) {
+            Customer *c = all[rng() % all.size()];
+            CHECK(describe(c) == savedAs(c));
+            CHECK(cache.residentCount() <= 8);
+        }
+        flights.forEach([](Record *r) {
+            Flight *f = static_cast<Flight*>(r);
+            f->forEachPassenger([f](int seat, Customer *c) { CHECK(c->getFlightId() == f->getId() && c->getSeatNum() == seat); });
+        });
+        CHECK(cache.failures() == 0);
+
+        // the file is cut short underneath the cache, so the records that aren't in memory can't be read any more
+        writeFile(path, file.substr(0, 8));
+        for (Customer *c : all) {
+            size_t failures = cache.failures();
+            std::string details = describe(c);
+            CHECK(details == savedAs(c) || cache.failures() != failures);
+        }
+        CHECK(cache.failures() > 0);
+
+        // and once it is back, they can
+        writeFile(path, file);
+        size_t failures = cache.failures();
+        for (Customer *c : all) CHECK(describe(c) == savedAs(c));
+        CHECK(cache.failures() == failures);
+    }
+    Customer::cache = nullptr;
+    cache.close();
+
+    // the Database reports the records it can't read as DISK_ERROR
+    // someone is the last customer, so their record is near the end of the file, well past what the reader has buffered
+    // from the start of it, and their flight has them on it at least
+    const std::string &someone = saved.rbegin()->first;
+    std::string name = someone.substr(0, someone.find(", ")), phonenum = someone.substr(name.size() + 2);
+    std::string flightId = saved.rbegin()->second.substr(saved.rbegin()->second.find(", AC") + 2, 5);
+    std::vector<Customer*> matches;
+    std::string manifest;
+    Customer *customer;
+    {
+        Database db(path);
+        writeFile(path, file.substr(0, 8));
+        CHECK(db.queryFlight(flightId, false, false, manifest) == Database::DISK_ERROR && manifest.empty());
+        CHECK(db.find(name, phonenum, customer) == Database::DISK_ERROR);
+        CHECK(db.searchNames("Customer", 20, matches) == Database::DISK_ERROR);
+
+        writeFile(path, file);
+        CHECK(db.queryFlight(flightId, false, false, manifest) == Database::OK);
+        CHECK(manifest.find("Customer") != std::string::npos);
+        CHECK(db.searchNames("Customer", 20, matches) == Database::OK && matches.size() == 20);
+        for (Customer *c : matches) CHECK(describe(c) == savedAs(c));
+        CHECK(db.find(name, phonenum, customer) == Database::OK && describe(customer) == saved.rbegin()->second);
+    }
+    std::remove(path.c_str());
+}
+
+// everything in a saved file as text, flights first, so two files can be compared (see Snapshot::scan)
+static std::string describeFile(const std::string &path) {
+    std::string text;
+    bool ok = Snapshot::scan(path, [&text](const Snapshot::FlightRow &f) {
+        text += f.id + " " + std::to_string(f.seats) + " " + std::to_string(f.occupied) + "\n";
+    }, [&text](const Snapshot::CustomerRow &c) {
+        text += describe(c.name, c.phonenum, c.address, c.flightId, c.seat) + "\n";
+    });
+    return ok ? text : "unreadable";
+}
+
+// version 1 of the file: the current layout without the flags byte, and with the key columns written out in full
+static std::string writeVersion1(const std::vector<Flight*> &flights, const std::vector<Customer*> &customers) {
+    std::ostringstream out;
+    {
+        ByteWriter w(out);
+        w.putBytes("AIRS\x01", 5);
+        w.putVarint(flights.size());
+        for (Flight *f : flights) encodeField(w, f->getId());
+        for (Flight *f : flights) w.putVarint(fieldSize(f->getSize()));
+        for (Flight *f : flights) encodeField(w, f->getSize());
+
+        w.putVarint(customers.size());
+        for (Customer *c : customers) encodeField(w, c->getName());
+        for (Customer *c : customers) encodeField(w, c->getPhoneNumber());
+        std::map<Customer*, long long> offsets; // where each payload starts, counted from the first one
+        long long offset = 0;
+        for (Customer *c : customers) {
+            size_t size = fieldSize(c->getAddress()) + fieldSize(c->getFlightId()) + fieldSize(c->getSeatNum());
+            w.putVarint(size);
+            offsets[c] = offset;
+            offset += size;
+        }
+        for (Customer *c : customers) {
+            encodeField(w, c->getAddress());
+            encodeField(w, c->getFlightId());
+            encodeField(w, c->getSeatNum());
+        }
+        for (Flight *f : flights) {
+            w.putVarint(f->getOccupiedCount());
+            int previous = -1;
+            f->forEachPassenger([&](int seat, Customer *c) {
+                w.putVarint(seat - previous - 1);
+                w.putVarint(offsets[c]);
+                previous = seat;
+            });
+        }
+    }
+    return out.str();
+}
+
+// the original file: both trees dumped node by node, with 4 byte ints (see Snapshot::loadOriginal)
+// the records are given in sorted order, and written as the balanced tree they would have been in
+static void putOriginalInt(std::string &out, int i) {
+    for (int b = 0; b < 4; b++) out += static_cast<char>(static_cast<unsigned>(i) >> 8 * b & 0xff);
+}
+static void putOriginalString(std::string &out, const std::string &s) {
+    putOriginalInt(out, s.size());
+    out += s;
+}
+template<class T, class PutRecord>
+static void putOriginalNode(std::string &out, const std::vector<T*> &records, size_t from, size_t to, PutRecord putRecord) {
+    size_t middle = (from + to) / 2;
+    out += static_cast<char>(middle % 2); // the colour, which is ignored
+    putRecord(records[middle]);
+    out += static_cast<char>(from < middle);
+    if (from < middle) putOriginalNode(out, records, from, middle, putRecord);
+    out += static_cast<char>(middle + 1 < to);
+    if (middle + 1 < to) putOriginalNode(out, records, middle + 1, to, putRecord);
+}
+static std::string writeOriginal(const std::vector<Flight*> &flights, const std::vector<Customer*> &customers) {
+    std::string out;
+    out += static_cast<char>(!flights.empty());
+    if (!flights.empty()) putOriginalNode(out, flights, 0, flights.size(), [&out](Flight *f) {
+        putOriginalString(out, f->getId());
+        putOriginalInt(out, f->getSize());
+    });
+    out += static_cast<char>(!customers.empty());
+    if (!customers.empty()) putOriginalNode(out, customers, 0, customers.size(), [&out](Customer *c) {
+        putOriginalString(out, c->getName());
+        putOriginalString(out, c->getAddress());
+        putOriginalString(out, c->getPhoneNumber());
+        putOriginalString(out, c->getFlightId());
+        putOriginalInt(out, c->getSeatNum());
+    });
+    return out;
+}
+
+// files from older versions have to load with everything that was in them, and get saved again in the current format,
+// while a file from a newer version is left exactly as it is
+static void checkUpgrades() {
+    std::mt19937 rng(28);
+    std::string path = tempFile("upgrade.dat");
+    fillDatabase(path, 30, rng);
+    std::string current = describeFile(path);
+    CHECK(current != "unreadable");
+
+    RBTree flights;
+    ShardedCustomerStore customers(1);
+    CHECK(Snapshot::load(path, flights, customers, false) == Snapshot::LOADED);
+    std::vector<Flight*> flightList;
+    std::vector<Customer*> customerList;
+    flights.forEach([&flightList](Record *r) { flightList.push_back(static_cast<Flight*>(r)); });
+    customers.forEach([&customerList](Record *r) { customerList.push_back(static_cast<Customer*>(r)); });
+
+    for (const std::string &old : {writeVersion1(flightList, customerList), writeOriginal(flightList, customerList)}) {
+        writeFile(path, old);
+        {
+            RBTree oldFlights;
+            ShardedCustomerStore oldCustomers(1);
+            CHECK(Snapshot::load(path, oldFlights, oldCustomers, true) == Snapshot::UPGRADED); // never lazily
+            CHECK(oldFlights.size() == flights.size() && oldCustomers.size() == customers.size());
+            CHECK(oldFlights.isValid());
+        }
+        {
+            Database db(path); // saves it again as soon as it is loaded
+            CHECK(db.getLoadProblem().empty());
+        }
+        CHECK(readFile(path) != old && describeFile(path) == current);
+        RBTree newFlights;
+        ShardedCustomerStore newCustomers(1);
+        CHECK(Snapshot::load(path, newFlights, newCustomers, true) == Snapshot::LOADED);
+    }
+
+    // the original format with nothing in it, which is just two empty trees
+    writeFile(path, std::string(2, '\0'));
+    {
+        Database db(path);
+        CHECK(db.getLoadProblem().empty() && db.getFlight("AC100") == nullptr);
+        CHECK(db.addFlight("AC100", 10) == Database::OK);
+    }
+    CHECK(describeFile(path) == "AC100 10 0\n");
+
+    // a version this program doesn't know yet
+    std::string newer = readFile(path);
+    newer[4] = 3;
+    writeFile(path, newer);
+    {
+        RBTree newerFlights;
+        ShardedCustomerStore newerCustomers(1);
+        CHECK(Snapshot::load(path, newerFlights, newerCustomers, true) == Snapshot::UNREADABLE);
+        CHECK(newerFlights.size() == 0 && newerCustomers.size() == 0);
+        Database db(path);
+        CHECK(!db.getLoadProblem().empty());
+        CHECK(db.addFlight("AC200", 10) == Database::DISK_ERROR);
+    }
+    CHECK(readFile(path) == newer);
+    std::remove(path.c_str());
+}
+
+// saving and loading again has to give back the same database, compressed or not, and whether customers are loaded lazily
+// or not, and a lazily loaded database has to save the customers it never loaded as well
+static void checkRoundTrip() {
+    std::mt19937 rng(29);
+    std::string path = tempFile("roundtrip.dat"), copyPath = tempFile("roundtrip-copy.dat");
+    fillDatabase(path, 50, rng);
+    std::string expected = describeFile(path);
+    std::map<std::string, std::string> saved = savedCustomers(path);
+
+    RBTree flights;
+    ShardedCustomerStore customers(1);
+    CHECK(Snapshot::load(path, flights, customers, false) == Snapshot::LOADED);
+    size_t sizes[2] = {};
+    for (bool compress : {false, true}) {
+        Snapshot::Offsets offsets;
+        CHECK(Snapshot::save(path, flights, customers, compress, offsets));
+        CHECK(describeFile(path) == expected);
+        sizes[compress] = readFile(path).size();
+
+        for (bool lazy : {false, true}) {
+            CustomerCache cache(16);
+            if (lazy) {
+                Customer::cache = &cache;
+                cache.open(path);
+            }
+            {
+                RBTree loadedFlights;
+                ShardedCustomerStore loadedCustomers(4); // a different number of shards than it was saved from
+                CHECK(Snapshot::load(path, loadedFlights, loadedCustomers, lazy) == Snapshot::LOADED);
+                CHECK(loadedFlights.isValid() && loadedFlights.size() == flights.size());
+                std::map<std::string, std::string> loaded;
+                loadedCustomers.forEach([&loaded](Record *r) {
+                    Customer *c = static_cast<Customer*>(r);
+                    loaded[c->getName() + ", " + c->getPhoneNumber()] = describe(c);
+                });
+                CHECK(loaded == saved);
+                int seated = 0;
+                loadedFlights.forEach([&seated](Record *r) {
+                    Flight *f = static_cast<Flight*>(r);
+                    f->forEachPassenger([f, &seated](int seat, Customer *c) {
+                        CHECK(c->getFlightId() == f->getId() && c->getSeatNum() == seat);
+                        seated++;
+                    });
+                });
+                CHECK(seated == static_cast<int>(saved.size()));
+
+                // most customers are stubs again by now, so they are copied over from the file without being decoded
+                CHECK(Snapshot::save(copyPath, loadedFlights, loadedCustomers, !compress, offsets));
+                CHECK(describeFile(copyPath) == expected);
+                CHECK(cache.failures() == 0);
+            }
+            Customer::cache = nullptr;
+            cache.close();
+        }
+    }
+    CHECK(sizes[true] < sizes[false]);
+    std::remove(path.c_str());
+    std::remove(copyPath.c_str());
+}
+
+// every field an Operation can have, as one line, to compare a recorded operation with the one read back
+static std::string describe(const Operation &op) {
+    std::string text = std::string(Operation::typeName(op.type)) + " " + op.flightId + " " + op.name + " " + op.address + " "
+                       + op.phonenum + " " + std::to_string(op.number) + " " + std::to_string(op.occupiedOnly)
+                       + std::to_string(op.sortByName);
+    for (const Passenger &p : op.group) text += " [" + p.name + " " + p.address + " " + p.phonenum + "]";
+    return text;
+}
+
+// a recorded trace has to read back as the same operations in the same order, including traces from older versions
+// (which are the same, except that they only have the operation types that existed then), and a trace that was cut off
+// part way through has to give the operations before that
+static void checkTraces() {
+    std::mt19937 rng(32);
+    std::string path = tempFile("trace.bin");
+    // version 1 had the first six types, version 2 added BOOK_ANY_SEAT and BOOK_GROUP, version 3 SEARCH_NAME
+    const int lastType[4] = {0, Operation::CANCEL, Operation::BOOK_GROUP, Operation::SEARCH_NAME};
+
+    for (int version = 1; version <= 3; version++) {
+        std::vector<Operation> ops(500);
+        {
+            TraceRecorder recorder(path);
+            CHECK(recorder.good());
+            for (Operation &op : ops) {
+                op.type = static_cast<Operation::Type>(Operation::ADD_FLIGHT + rng() % lastType[version]);
+                std::string n = std::to_string(rng() % 100000);
+                if (op.type != Operation::FIND && op.type != Operation::CANCEL && op.type != Operation::SEARCH_NAME) op.flightId = "AC" + n;
+                if (op.type != Operation::ADD_FLIGHT && op.type != Operation::REMOVE_FLIGHT && op.type != Operation::QUERY_FLIGHT
+                    && op.type != Operation::BOOK_GROUP) {
+                    op.name = "Customer " + n;
+                    if (op.type != Operation::SEARCH_NAME) op.phonenum = "(555) 555-" + n;
+                    if (op.type == Operation::BOOK || op.type == Operation::BOOK_ANY_SEAT) op.address = n + " Main St";
+                }
+                if (op.type == Operation::ADD_FLIGHT || op.type == Operation::BOOK || op.type == Operation::SEARCH_NAME)
+                    op.number = rng() % 1000 - (op.type == Operation::BOOK ? 500 : 0); // negative ones are written too
+                if (op.type == Operation::QUERY_FLIGHT) {
+                    op.occupiedOnly = rng() % 2;
+                    op.sortByName = rng() % 2;
+                }
+                if (op.type == Operation::BOOK_GROUP)
+                    for (unsigned i = rng() % 5; i > 0; i--) op.group.push_back({"Member " + n, n + " Main St", std::to_string(i)});
+                recorder.record(op);
+            }
+        }
+        std::string trace = readFile(path);
+        trace[4] = version; // everything after the version byte is the same in every version
+        writeFile(path, trace);
+
+        TraceReader reader(path);
+        CHECK(reader.good());
+        Operation op;
+        long long time = 0;
+        for (const Operation &recorded : ops) {
+            CHECK(reader.next(op) && describe(op) == describe(recorded) && op.time >= time);
+            time = op.time;
+        }
+        CHECK(!reader.next(op));
+
+        // cut off at random points, the operations that are complete still come out
+        for (int i = 0; i < 20; i++) {
+            size_t length = 5 + rng() % (trace.size() - 5);
+            writeFile(path, trace.substr(0, length));
+            TraceReader cut(path);
+            CHECK(cut.good());
+            size_t read = 0;
+            while (cut.next(op)) CHECK(read < ops.size() && describe(op) == describe(ops[read++]));
+            CHECK(read < ops.size());
+        }
+    }
+
+    // not a trace, or from a newer version
+    writeFile(path, "AIRT");
+    CHECK(!TraceReader(path).good());
+    writeFile(path, std::string("AIRT\x04", 5));
+    CHECK(!TraceReader(path).good());
+    writeFile(path, std::string("AIRS\x03", 5));
+    CHECK(!TraceReader(path).good());
+    std::remove(path.c_str());
+}
+
+// exports of a small database, with every kind of character that needs quoting or escaping, have to be exactly as
+// documented in Exporter.h, and a file that isn't a database must not produce (or empty out) an export
+static void checkExports() {
+    std::string path = tempFile("export.dat"), csvPath = tempFile("export.csv"), jsonPath = tempFile("export.json");
+    std::remove(path.c_str());
+    long long rows;
+    {
+        Database db(path);
+        db.addFlight("AC100", 3);
+        db.removeFlight("AC100");
+    }
+    CHECK(Exporter::exportSnapshot(path, csvPath, Exporter::CSV, rows) && rows == 0);
+    CHECK(readFile(csvPath) == "record,flight,seats,occupied,seat,name,phone,address\n");
+    CHECK(Exporter::exportSnapshot(path, jsonPath, Exporter::JSON, rows) && rows == 0);
+    CHECK(readFile(jsonPath) == "{\"flights\":[\n],\"customers\":[\n]}\n");
+
+    {
+        Database db(path);
+        db.addFlight("AC100", 3);
+        db.addFlight("AC200", 2);
+        db.book("Anna \"Ann\" Smith", "1 Main St, Springfield", "(555) 555-5555", "AC100", 1);
+        db.book("Bob\\Jr", "Line1\nLine2\t", "(555) 555-0001", "AC200", 0);
+    }
+    CHECK(Exporter::formatFor(csvPath) == Exporter::CSV && Exporter::formatFor(jsonPath) == Exporter::JSON);
+    CHECK(Exporter::exportSnapshot(path, csvPath, Exporter::CSV, rows) && rows == 4);
+    CHECK(readFile(csvPath) ==
+          "record,flight,seats,occupied,seat,name,phone,address\n"
+          "flight,AC100,3,1,,,,\n"
+          "flight,AC200,2,1,,,,\n"
+          "customer,AC100,,,1,\"Anna \"\"Ann\"\" Smith\",(555) 555-5555,\"1 Main St, Springfield\"\n"
+          "customer,AC200,,,0,Bob\\Jr,(555) 555-0001,\"Line1\nLine2\t\"\n");
+    CHECK(Exporter::exportSnapshot(path, jsonPath, Exporter::JSON, rows) && rows == 4);
+    CHECK(readFile(jsonPath) ==
+          "{\"flights\":[\n"
+          "{\"id\":\"AC100\",\"seats\":3,\"occupied\":1},\n"
+          "{\"id\":\"AC200\",\"seats\":2,\"occupied\":1}\n"
+          "],\"customers\":[\n"
+          "{\"name\":\"Anna \\\"Ann\\\" Smith\",\"phone\":\"(555) 555-5555\",\"address\":\"1 Main St, Springfield\",\"flight\":\"AC100\",\"seat\":1},\n"
+          "{\"name\":\"Bob\\\\Jr\",\"phone\":\"(555) 555-0001\",\"address\":\"Line1\\u000aLine2\\u0009\",\"flight\":\"AC200\",\"seat\":0}\n"
+          "]}\n");
+
+    // a bigger database has a row for every flight and customer in it
+    std::mt19937 rng(38);
+    fillDatabase(path, 40, rng);
+    size_t lines = 0;
+    for (char c : describeFile(path)) lines += c == '\n';
+    CHECK(Exporter::exportSnapshot(path, csvPath, Exporter::CSV, rows) && rows == static_cast<long long>(lines));
+    std::string csv = readFile(csvPath);
+    CHECK(std::count(csv.begin(), csv.end(), '\n') == rows + 1); // nothing in it needs quoting, so one line per row
+
+    // something that isn't a database leaves the export as it was
+    writeFile(path, "not a database");
+    CHECK(!Exporter::exportSnapshot(path, csvPath, Exporter::CSV, rows));
+    CHECK(readFile(csvPath) == csv);
+    std::remove(path.c_str());
+    std::remove(csvPath.c_str());
+    std::remove(jsonPath.c_str());
+}
+
+struct Check {
+    const char *name;
+    void (*run)();
+};
+
+static const Check checks[] = {
+    {"red-black tree", checkTree},
+    {"bulk erase", checkEraseAll},
+    {"seat map", checkSeatMap},
+    {"seat allocator", checkSeatAllocator},
+    {"name index", checkNameIndex},
+    {"iterators", checkIterators},
+    {"corrupt database files", checkCorruptFiles},
+    {"lazy customers", checkLazyCustomers},
+    {"older file formats", checkUpgrades},
+    {"save and load", checkRoundTrip},
+    {"manifest cache", checkManifestCache},
+    {"operation traces", checkTraces},
+    {"exports", checkExports},
+};
+
+bool selfTest() {
+    int failed = 0;
+    for (const Check &check : checks) {
+        failures = 0;
+        check.run();
+        printf("%-28s %s\n", check.name, failures == 0 ? "ok" : "FAILED");
+        fflush(stdout);
+        if (failures != 0) failed++;
+    }
+    printf("%d of %d checks failed\n", failed, static_cast<int>(sizeof(checks) / sizeof(checks[0])));
+    return failed == 0;
+}
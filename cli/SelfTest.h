@@ -0,0 +1,16 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+/*
+    Randomized checks that can be run from the console version of the program (see main.cpp)
+    each check does a lot of random operations on one of the data structures, and compares the results against
+    a simple but obviously correct version (usually a std::set or a brute force search) after every step
+    the file checks write databases and traces to the temporary folder and read them back, including damaged ones
+    the random numbers come from a fixed seed, so a failure can always be reproduced by running it again
+*/
+
+// runs every check and prints one line for each, followed by the file and line of every failed CHECK
+// returns true if everything passed
+bool selfTest();
+
+#endif // SELFTEST_H
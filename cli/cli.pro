@@ -0,0 +1,61 @@
+# Console version of the program, for things that don't need the GUI (benchmarks and other tools)
+# build it the same way as QTTest.pro, it uses the same database sources from the folder above
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# "qmake CONFIG+=stats" compiles in the counters and timers from Stats.h
+stats: DEFINES += AIRLINE_STATS
+
+TARGET = airline-cli
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../Customer.cpp \
+    ../CustomerCache.cpp \
+    ../Database.cpp \
+    ../Exporter.cpp \
+    ../Flight.cpp \
+    ../LatencyHistogram.cpp \
+    ../ManifestCache.cpp \
+    ../NameIndex.cpp \
+    ../OperationTrace.cpp \
+    ../RBNode.cpp \
+    ../RBTree.cpp \
+    ../SeatAllocator.cpp \
+    ../SeatMap.cpp \
+    ../Serialization.cpp \
+    ../ShardedCustomerStore.cpp \
+    ../Snapshot.cpp \
+    ../Stats.cpp \
+    Benchmarks.cpp \
+    Replay.cpp \
+    SelfTest.cpp \
+    main.cpp
+
+HEADERS += \
+    ../Customer.h \
+    ../CustomerCache.h \
+    ../Database.h \
+    ../Exporter.h \
+    ../Flight.h \
+    ../LatencyHistogram.h \
+    ../ManifestCache.h \
+    ../NameIndex.h \
+    ../OperationTrace.h \
+    ../RBNode.h \
+    ../RBTree.h \
+    ../Record.h \
+    ../SeatAllocator.h \
+    ../SeatMap.h \
+    ../Serialization.h \
+    ../ShardedCustomerStore.h \
+    ../Snapshot.h \
+    ../Stats.h \
+    Benchmarks.h \
+    Replay.h \
+    SelfTest.h
@@ -0,0 +1,73 @@
+#include "Benchmarks.h"
+#include "Replay.h"
+#include "SelfTest.h"
+#include "Exporter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void usage() {
+    printf("usage:\n");
+    printf("  airline-cli bench-shards [bookings per thread]\n");
+    printf("  airline-cli bench-traversal [number of customers]\n");
+    printf("  airline-cli replay <trace file> [--from <database file>] [--timed] [--json <output file>]\n");
+    printf("  airline-cli generate-trace <trace file> [number of operations]\n");
+    printf("  airline-cli export <database file> <output file> [--csv | --json]\n");
+    printf("  airline-cli self-test\n");
+}
+
+// console entry point, the first argument picks what to run
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench-shards") == 0) {
+        benchShards(argc > 2 ? atoi(argv[2]) : 200000);
+        return 0;
+    }
+    if (strcmp(argv[1], "bench-traversal") == 0) {
+        benchTraversal(argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (strcmp(argv[1], "replay") == 0 && argc > 2) {
+        ReplayOptions options;
+        options.tracePath = argv[2];
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--timed") == 0) options.timed = true;
+            else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) options.startingDatabase = argv[++i];
+            else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) options.jsonPath = argv[++i];
+            else {
+                usage();
+                return 1;
+            }
+        }
+        return replay(options) ? 0 : 1;
+    }
+    if (strcmp(argv[1], "generate-trace") == 0 && argc > 2) {
+        return generateTrace(argv[2], argc > 3 ? atoi(argv[3]) : 10000) ? 0 : 1;
+    }
+    if (strcmp(argv[1], "self-test") == 0) {
+        return selfTest() ? 0 : 1;
+    }
+    if (strcmp(argv[1], "export") == 0 && argc > 3) {
+        Exporter::Format format = Exporter::formatFor(argv[3]); // from the file name, unless it is given
+        if (argc > 4 && strcmp(argv[4], "--csv") == 0) format = Exporter::CSV;
+        else if (argc > 4 && strcmp(argv[4], "--json") == 0) format = Exporter::JSON;
+
+        auto start = std::chrono::steady_clock::now();
+        long long rows;
+        if (!Exporter::exportSnapshot(argv[2], argv[3], format, rows)) {
+            fprintf(stderr, "export failed, is %s a database file?\n", argv[2]);
+            return 1;
+        }
+        printf("exported %lld rows in %.2f s\n", rows, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return 0;
+    }
+
+    usage();
+    return 1;
+}
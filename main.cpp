@@ -3,9 +3,15 @@
 #include <QApplication>
 
 // main function starts Qt
+// running it with "--record <trace file>" records every operation for the console program to replay
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
     MainWindow w;
+
+    QStringList args = a.arguments();
+    int record = args.indexOf("--record");
+    if (record != -1 && record + 1 < args.size()) w.startRecording(args[record + 1]);
+
     w.show();
     return a.exec();
 }